@@ -7,9 +7,14 @@
 #ifndef _BINDING_MAP_H
 #define _BINDING_MAP_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
 #include <memory>
 #include "Common.h"
 #include "ElunaUtility.h"
+#include "Hooks.h"
 #include <type_traits>
 
 extern "C"
@@ -18,196 +23,6 @@ extern "C"
 #include "lauxlib.h"
 };
 
-class BaseBindingMap
-{
-public:
-    virtual ~BaseBindingMap() = default;
-};
-
-/*
- * A set of bindings from keys of type `K` to Lua references.
- */
-template<typename K>
-class BindingMap : public BaseBindingMap
-{
-private:
-    lua_State* L;
-    uint64 maxBindingID;
-
-    struct Binding
-    {
-        uint64 id;
-        lua_State* L;
-        uint32 remainingShots;
-        int functionReference;
-
-        Binding(lua_State* L, uint64 id, int functionReference, uint32 remainingShots) :
-            id(id),
-            L(L),
-            remainingShots(remainingShots),
-            functionReference(functionReference)
-        { }
-
-        ~Binding()
-        {
-            luaL_unref(L, LUA_REGISTRYINDEX, functionReference);
-        }
-    };
-
-    typedef std::vector< std::unique_ptr<Binding> > BindingList;
-
-    std::unordered_map<K, BindingList> bindings;
-    /*
-     * This table is for fast removal of bindings by ID.
-     *
-     * Instead of having to look through (potentially) every BindingList to find
-     *   the Binding with the right ID, this allows you to go directly to the
-     *   BindingList that might have the Binding with that ID.
-     *
-     * However, you must be careful not to store pointers to BindingLists
-     *   that no longer exist (see `void Clear(const K& key)` implementation).
-     */
-    std::unordered_map<uint64, BindingList*> id_lookup_table;
-
-public:
-    BindingMap(lua_State* L) :
-        L(L),
-        maxBindingID(0)
-    { }
-
-    ~BindingMap() noexcept override = default;
-
-    /*
-     * Insert a new binding from `key` to `ref`, which lasts for `shots`-many pushes.
-     *
-     * If `shots` is 0, it will never automatically expire, but can still be
-     *   removed with `Clear` or `Remove`.
-     */
-    uint64 Insert(const K& key, int ref, uint32 shots)
-    {
-        uint64 id = (++maxBindingID);
-        BindingList& list = bindings[key];
-        list.push_back(std::unique_ptr<Binding>(new Binding(L, id, ref, shots)));
-        id_lookup_table[id] = &list;
-        return id;
-    }
-
-    /*
-     * Clear all bindings for `key`.
-     */
-    void Clear(const K& key)
-    {
-        if (bindings.empty())
-            return;
-
-        auto iter = bindings.find(key);
-        if (iter == bindings.end())
-            return;
-
-        BindingList& list = iter->second;
-
-        // Remove all pointers to `list` from `id_lookup_table`.
-        for (auto i = list.begin(); i != list.end(); ++i)
-        {
-            std::unique_ptr<Binding>& binding = *i;
-            id_lookup_table.erase(binding->id);
-        }
-
-        bindings.erase(key);
-    }
-
-    /*
-     * Clear all bindings for all keys.
-     */
-    void Clear()
-    {
-        if (bindings.empty())
-            return;
-
-        id_lookup_table.clear();
-        bindings.clear();
-    }
-
-    /*
-     * Remove a specific binding identified by `id`.
-     *
-     * If `id` in invalid, nothing is removed.
-     */
-    void Remove(uint64 id)
-    {
-        auto iter = id_lookup_table.find(id);
-        if (iter == id_lookup_table.end())
-            return;
-
-        BindingList* list = iter->second;
-        auto i = list->begin();
-
-        for (; i != list->end(); ++i)
-        {
-            std::unique_ptr<Binding>& binding = *i;
-            if (binding->id == id)
-                break;
-        }
-
-        if (i != list->end())
-            list->erase(i);
-
-        // Unconditionally erase the ID in the lookup table because
-        //   it was either already invalid, or it's no longer valid.
-        id_lookup_table.erase(id);
-    }
-
-    /*
-     * Check whether `key` has any bindings.
-     */
-    bool HasBindingsFor(const K& key)
-    {
-        if (bindings.empty())
-            return false;
-
-        auto result = bindings.find(key);
-        if (result == bindings.end())
-            return false;
-
-        BindingList& list = result->second;
-        return !list.empty();
-    }
-
-    /*
-     * Push all Lua references for `key` onto the stack.
-     */
-    void PushRefsFor(const K& key)
-    {
-        if (bindings.empty())
-            return;
-
-        auto result = bindings.find(key);
-        if (result == bindings.end())
-            return;
-
-        BindingList& list = result->second;
-        for (auto i = list.begin(); i != list.end();)
-        {
-            std::unique_ptr<Binding>& binding = (*i);
-            auto i_prev = (i++);
-
-            lua_rawgeti(L, LUA_REGISTRYINDEX, binding->functionReference);
-
-            if (binding->remainingShots > 0)
-            {
-                binding->remainingShots -= 1;
-
-                if (binding->remainingShots == 0)
-                {
-                    id_lookup_table.erase(binding->id);
-                    list.erase(i_prev);
-                }
-            }
-        }
-    }
-};
-
-
 /*
  * A `BindingMap` key type for simple event ID bindings
  *   (ServerEvents, GuildEvents, etc.).
@@ -274,7 +89,7 @@ public:
     {
         return std::hash<typename std::underlying_type<T>::type>()(t);
     }
-    
+
     template <typename T, typename std::enable_if<!std::is_enum<T>::value>::type* = nullptr>
     static inline result_type hash(T const & t)
     {
@@ -367,4 +182,736 @@ namespace std
     };
 }
 
+/*
+ * A single handler bound to a key, stored inline in its key's `BindingList`.
+ *
+ * The Lua reference is owned by the `BindingMap` the record lives in,
+ *   which unrefs it when the record is removed.
+ */
+struct Binding
+{
+    uint64 id;
+    int functionReference;
+    uint32 remainingShots;
+
+    uint32 errors = 0;           // Errors since `errorWindowStart`
+    uint32 errorWindowStart = 0; // Time of the first error counted in `errors`
+    uint32 quarantines = 0;      // Times the binding was quarantined, each quarantine lasts twice as long as the previous
+    uint32 quarantinedUntil = 0; // Time the binding is called again, 0 if it is not quarantined
+};
+
+/*
+ * The bindings of one key, in the order they were added.
+ *
+ * `handlersRef` references a Lua array of the bound functions in the same order,
+ *   which hooks call through instead of pushing each function. It is built on the first
+ *   call after the bindings change and released by the `BindingMap` on every change.
+ */
+struct BindingList
+{
+    std::vector<Binding> bindings;
+    int handlersRef = LUA_NOREF;
+    // Number of functions in the handler array, quarantined bindings are left out of it
+    uint32 handlerCount = 0;
+    // Number of bindings that expire after some calls, 0 lets calls skip counting down shots
+    uint32 limitedBindings = 0;
+    // Number of quarantined bindings, 0 lets calls skip checking for quarantines that ended
+    uint32 quarantinedBindings = 0;
+
+    bool empty() const { return bindings.empty(); }
+    size_t size() const { return bindings.size(); }
+
+    void clear()
+    {
+        bindings.clear();
+        handlersRef = LUA_NOREF;
+        handlerCount = 0;
+        limitedBindings = 0;
+        quarantinedBindings = 0;
+    }
+};
+
+/*
+ * Storage used by `BindingMap` to find the `BindingList` of a key.
+ *
+ * The generic version hashes the key into an unordered_map.
+ *   Specializations below provide flat storage for the dense key types.
+ *
+ * Every storage provides:
+ *   `Find(key)`    - the list for `key`, or NULL if there is none
+ *   `Get(key)`     - the list for `key`, creating an empty one if needed
+ *   `Erase(key)`   - drops the (already emptied) list for `key`
+ *   `Clear()`      - drops all lists
+ *   `Empty()`      - whether no list exists at all
+ *   `ForEach(f)`   - calls `f(list)` for every list
+ */
+template<typename K>
+class BindingStorage
+{
+public:
+    BindingList* Find(const K& key)
+    {
+        if (lists.empty())
+            return nullptr;
+
+        auto itr = lists.find(key);
+        return itr != lists.end() ? &itr->second : nullptr;
+    }
+
+    BindingList& Get(const K& key) { return lists[key]; }
+    void Erase(const K& key) { lists.erase(key); }
+    void Clear() { lists.clear(); }
+    bool Empty() const { return lists.empty(); }
+
+    template<typename F>
+    void ForEach(F&& f)
+    {
+        for (auto& itr : lists)
+            f(itr.second);
+    }
+
+private:
+    std::unordered_map<K, BindingList> lists;
+};
+
+/*
+ * Event IDs are dense enums bounded by their `*_EVENT_COUNT`,
+ *   so the lists are indexed directly by event ID.
+ */
+template<typename T>
+class BindingStorage< EventKey<T> >
+{
+public:
+    static constexpr size_t EVENT_COUNT = Hooks::EventCount<T>::value;
+
+    BindingList* Find(const EventKey<T>& key)
+    {
+        size_t index = static_cast<size_t>(key.event_id);
+        if (index >= EVENT_COUNT)
+            return nullptr;
+
+        return &lists[index];
+    }
+
+    BindingList& Get(const EventKey<T>& key)
+    {
+        size_t index = static_cast<size_t>(key.event_id);
+        ASSERT(index < EVENT_COUNT);
+        ++used;
+        return lists[index];
+    }
+
+    void Erase(const EventKey<T>& key)
+    {
+        size_t index = static_cast<size_t>(key.event_id);
+        if (index < EVENT_COUNT && used)
+        {
+            lists[index].clear();
+            --used;
+        }
+    }
+
+    void Clear()
+    {
+        for (BindingList& list : lists)
+            list.clear();
+        used = 0;
+    }
+
+    bool Empty() const { return used == 0; }
+
+    template<typename F>
+    void ForEach(F&& f)
+    {
+        for (BindingList& list : lists)
+            if (!list.empty())
+                f(list);
+    }
+
+private:
+    std::array<BindingList, EVENT_COUNT> lists;
+    // Number of `Get` calls not yet matched by an `Erase`, only used to tell whether anything is stored
+    size_t used = 0;
+};
+
+/*
+ * Event ID/entry keys are packed into a single integer and stored in an
+ *   open addressing table with linear probing, keeping each key's
+ *   binding records inline in its slot.
+ *
+ * Erasing uses backward shift deletion, so no tombstones are left behind
+ *   for keys that come and go (e.g. instance IDs).
+ */
+template<typename T>
+class BindingStorage< EntryKey<T> >
+{
+public:
+    BindingList* Find(const EntryKey<T>& key)
+    {
+        if (!used)
+            return nullptr;
+
+        uint64 packed = Pack(key);
+        for (size_t i = Bucket(packed); ; i = (i + 1) & mask)
+        {
+            Slot& slot = slots[i];
+            if (slot.key == packed)
+                return &slot.list;
+            if (slot.key == EMPTY_SLOT)
+                return nullptr;
+        }
+    }
+
+    BindingList& Get(const EntryKey<T>& key)
+    {
+        // keep the load factor at or below 1/2 so probe sequences stay short
+        if ((used + 1) * 2 > slots.size())
+            Grow();
+
+        uint64 packed = Pack(key);
+        size_t i = Bucket(packed);
+        while (slots[i].key != EMPTY_SLOT && slots[i].key != packed)
+            i = (i + 1) & mask;
+
+        if (slots[i].key == EMPTY_SLOT)
+        {
+            slots[i].key = packed;
+            ++used;
+        }
+        return slots[i].list;
+    }
+
+    void Erase(const EntryKey<T>& key)
+    {
+        if (!used)
+            return;
+
+        uint64 packed = Pack(key);
+        size_t hole = Bucket(packed);
+        while (slots[hole].key != packed)
+        {
+            if (slots[hole].key == EMPTY_SLOT)
+                return;
+            hole = (hole + 1) & mask;
+        }
+
+        // shift following entries of the probe sequence back into the hole
+        for (size_t i = (hole + 1) & mask; slots[i].key != EMPTY_SLOT; i = (i + 1) & mask)
+        {
+            size_t home = Bucket(slots[i].key);
+            bool inRange = hole < i ? (home > hole && home <= i) : (home > hole || home <= i);
+            if (inRange)
+                continue;
+
+            slots[hole].key = slots[i].key;
+            slots[hole].list = std::move(slots[i].list);
+            hole = i;
+        }
+
+        slots[hole].key = EMPTY_SLOT;
+        slots[hole].list.clear();
+        --used;
+    }
+
+    void Clear()
+    {
+        slots.clear();
+        mask = 0;
+        used = 0;
+    }
+
+    bool Empty() const { return used == 0; }
+
+    template<typename F>
+    void ForEach(F&& f)
+    {
+        for (Slot& slot : slots)
+            if (slot.key != EMPTY_SLOT)
+                f(slot.list);
+    }
+
+private:
+    static constexpr uint64 EMPTY_SLOT = std::numeric_limits<uint64>::max();
+
+    struct Slot
+    {
+        uint64 key = EMPTY_SLOT;
+        BindingList list;
+    };
+
+    static uint64 Pack(const EntryKey<T>& key)
+    {
+        return (static_cast<uint64>(key.event_id) << 32) | key.entry;
+    }
+
+    size_t Bucket(uint64 packed) const
+    {
+        // fibonacci hashing spreads sequential entries over the table
+        return static_cast<size_t>((packed * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+
+        slots.resize(old.empty() ? 16 : old.size() * 2);
+        mask = slots.size() - 1;
+
+        for (Slot& slot : old)
+        {
+            if (slot.key == EMPTY_SLOT)
+                continue;
+
+            size_t i = Bucket(slot.key);
+            while (slots[i].key != EMPTY_SLOT)
+                i = (i + 1) & mask;
+
+            slots[i].key = slot.key;
+            slots[i].list = std::move(slot.list);
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t used = 0;
+};
+
+/*
+ * The part of `BindingMap` that calls can reach without knowing the key type.
+ *
+ * The handler arrays keep the map at index 0 and the ID of the binding of
+ *   the function at index `i` at index `-i`, so a failing call can find its binding.
+ */
+class BindingMapBase
+{
+public:
+    virtual ~BindingMapBase() { }
+
+    /*
+     * Count an error of the binding `id`, quarantining it after `maxErrors` errors within `window` ms.
+     *
+     * Returns how many ms the binding was quarantined for, 0 if it was not.
+     */
+    virtual uint32 RecordError(uint64 id, uint32 maxErrors, uint32 window, uint32 quarantineTime) = 0;
+};
+
+/*
+ * A set of bindings from keys of type `K` to Lua references.
+ */
+template<typename K>
+class BindingMap : public BindingMapBase
+{
+private:
+    typedef decltype(K::event_id) EventType;
+    static constexpr size_t EVENT_COUNT = Hooks::EventCount<EventType>::value;
+    static_assert(EVENT_COUNT <= Hooks::EVENT_ID_LIMIT, "event IDs must fit in Hooks::EventMask");
+
+    lua_State* L;
+    uint64 maxBindingID;
+
+    // Bits of the owning state's mask for this map's register type, see Eluna::HasAnyHandler
+    Hooks::EventMask* handlerMask;
+    // Number of bindings per event ID, the mask bit is set while the count is not 0
+    std::array<uint32, EVENT_COUNT> handlerCounts;
+    // Quarantined bindings of the owning state, see Eluna::GetQuarantinedHandlerCount
+    std::atomic<uint32>* quarantineCount;
+
+    BindingStorage<K> bindings;
+    /*
+     * This table is for fast removal of bindings by ID.
+     *
+     * Instead of having to look through (potentially) every BindingList to find
+     *   the Binding with the right ID, this allows you to go directly to the
+     *   key whose BindingList might have the Binding with that ID.
+     *
+     * Keys are stored instead of list pointers because the flat storages
+     *   move lists around when they grow or erase.
+     */
+    std::unordered_map<uint64, K> id_lookup_table;
+
+    void Unref(const Binding& binding)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, binding.functionReference);
+    }
+
+    // Drops the handler array of `list`, calls already running keep the array they pushed
+    void InvalidateHandlers(BindingList& list)
+    {
+        if (list.handlersRef == LUA_NOREF)
+            return;
+
+        luaL_unref(L, LUA_REGISTRYINDEX, list.handlersRef);
+        list.handlersRef = LUA_NOREF;
+    }
+
+    void SetQuarantine(BindingList& list, Binding& binding, uint32 until)
+    {
+        if (!binding.quarantinedUntil && until)
+        {
+            ++list.quarantinedBindings;
+            if (quarantineCount)
+                ++*quarantineCount;
+        }
+        else if (binding.quarantinedUntil && !until)
+        {
+            --list.quarantinedBindings;
+            if (quarantineCount)
+                --*quarantineCount;
+        }
+
+        binding.quarantinedUntil = until;
+        InvalidateHandlers(list);
+    }
+
+    // Releases the bindings of `list` whose quarantine ended
+    void ReleaseEndedQuarantines(BindingList& list)
+    {
+        uint32 now = ElunaUtil::GetCurrTime();
+        for (Binding& binding : list.bindings)
+            if (binding.quarantinedUntil && static_cast<int32>(now - binding.quarantinedUntil) >= 0)
+                SetQuarantine(list, binding, 0);
+    }
+
+    // Forgets the quarantined bindings of `list` that are about to be removed
+    void ForgetQuarantines(const BindingList& list)
+    {
+        if (quarantineCount)
+            *quarantineCount -= list.quarantinedBindings;
+    }
+
+    void AddHandlers(EventType event_id, uint32 count)
+    {
+        size_t index = static_cast<size_t>(event_id);
+        if (index >= EVENT_COUNT)
+            return;
+
+        if (!handlerCounts[index] && handlerMask)
+            handlerMask->set(index);
+        handlerCounts[index] += count;
+    }
+
+    void RemoveHandlers(EventType event_id, uint32 count)
+    {
+        size_t index = static_cast<size_t>(event_id);
+        if (index >= EVENT_COUNT)
+            return;
+
+        handlerCounts[index] -= count;
+        if (!handlerCounts[index] && handlerMask)
+            handlerMask->reset(index);
+    }
+
+public:
+    BindingMap(lua_State* L, Hooks::EventMask* handlerMask = nullptr, std::atomic<uint32>* quarantineCount = nullptr) :
+        L(L),
+        maxBindingID(0),
+        handlerMask(handlerMask),
+        quarantineCount(quarantineCount)
+    {
+        handlerCounts.fill(0);
+        if (handlerMask)
+            handlerMask->reset();
+    }
+
+    ~BindingMap()
+    {
+        Clear();
+    }
+
+    /*
+     * Insert a new binding from `key` to `ref`, which lasts for `shots`-many pushes.
+     *
+     * If `shots` is 0, it will never automatically expire, but can still be
+     *   removed with `Clear` or `Remove`.
+     */
+    uint64 Insert(const K& key, int ref, uint32 shots)
+    {
+        uint64 id = (++maxBindingID);
+        BindingList* list = bindings.Find(key);
+        if (!list || list->empty())
+            list = &bindings.Get(key);
+        list->bindings.push_back({ id, ref, shots });
+        if (shots > 0)
+            ++list->limitedBindings;
+        InvalidateHandlers(*list);
+        id_lookup_table.emplace(id, key);
+        AddHandlers(key.event_id, 1);
+        return id;
+    }
+
+    /*
+     * Clear all bindings for `key`.
+     */
+    void Clear(const K& key)
+    {
+        BindingList* list = bindings.Find(key);
+        if (!list || list->empty())
+            return;
+
+        // Remove all IDs of `list` from `id_lookup_table`.
+        for (const Binding& binding : list->bindings)
+        {
+            id_lookup_table.erase(binding.id);
+            Unref(binding);
+        }
+        InvalidateHandlers(*list);
+        ForgetQuarantines(*list);
+
+        RemoveHandlers(key.event_id, static_cast<uint32>(list->size()));
+        list->clear();
+        bindings.Erase(key);
+    }
+
+    /*
+     * Clear all bindings for all keys.
+     */
+    void Clear()
+    {
+        if (bindings.Empty())
+            return;
+
+        bindings.ForEach([this](BindingList& list)
+        {
+            for (const Binding& binding : list.bindings)
+                Unref(binding);
+            InvalidateHandlers(list);
+            ForgetQuarantines(list);
+        });
+
+        id_lookup_table.clear();
+        bindings.Clear();
+
+        handlerCounts.fill(0);
+        if (handlerMask)
+            handlerMask->reset();
+    }
+
+    /*
+     * Remove a specific binding identified by `id`.
+     *
+     * If `id` in invalid, nothing is removed.
+     */
+    void Remove(uint64 id)
+    {
+        auto iter = id_lookup_table.find(id);
+        if (iter == id_lookup_table.end())
+            return;
+
+        K key = iter->second;
+
+        // Unconditionally erase the ID in the lookup table because
+        //   it was either already invalid, or it's no longer valid.
+        id_lookup_table.erase(iter);
+
+        BindingList* list = bindings.Find(key);
+        if (!list)
+            return;
+
+        for (auto i = list->bindings.begin(); i != list->bindings.end(); ++i)
+        {
+            if (i->id != id)
+                continue;
+
+            if (i->remainingShots > 0)
+                --list->limitedBindings;
+            if (i->quarantinedUntil)
+                SetQuarantine(*list, *i, 0);
+            Unref(*i);
+            list->bindings.erase(i);
+            InvalidateHandlers(*list);
+            RemoveHandlers(key.event_id, 1);
+            break;
+        }
+
+        if (list->empty())
+            bindings.Erase(key);
+    }
+
+    /*
+     * Check whether `key` has any bindings.
+     */
+    bool HasBindingsFor(const K& key)
+    {
+        BindingList* list = bindings.Find(key);
+        return list && !list->empty();
+    }
+
+    /*
+     * Push the array of the functions bound to `key` onto the stack, or nil if there are none.
+     *
+     * Returns the number of functions in the array.
+     */
+    int PushHandlersFor(const K& key)
+    {
+        BindingList* list = bindings.Find(key);
+        if (!list || list->empty())
+        {
+            lua_pushnil(L);
+            return 0;
+        }
+
+        if (list->quarantinedBindings)
+            ReleaseEndedQuarantines(*list);
+
+        if (list->handlersRef == LUA_NOREF)
+        {
+            int count = static_cast<int>(list->size() - list->quarantinedBindings);
+            lua_createtable(L, count, count + 1);
+            count = 0;
+            for (const Binding& binding : list->bindings)
+            {
+                if (binding.quarantinedUntil)
+                    continue;
+
+                ++count;
+                lua_rawgeti(L, LUA_REGISTRYINDEX, binding.functionReference);
+                lua_rawseti(L, -2, count);
+                lua_pushnumber(L, static_cast<lua_Number>(binding.id));
+                lua_rawseti(L, -2, -count);
+            }
+            lua_pushlightuserdata(L, static_cast<BindingMapBase*>(this));
+            lua_rawseti(L, -2, 0);
+
+            lua_pushvalue(L, -1);
+            list->handlersRef = luaL_ref(L, LUA_REGISTRYINDEX);
+            list->handlerCount = static_cast<uint32>(count);
+        }
+        else
+            lua_rawgeti(L, LUA_REGISTRYINDEX, list->handlersRef);
+
+        int count = static_cast<int>(list->handlerCount);
+        if (list->limitedBindings)
+            CountDownShots(key, *list);
+
+        return count;
+    }
+
+    uint32 RecordError(uint64 id, uint32 maxErrors, uint32 window, uint32 quarantineTime) override
+    {
+        auto itr = id_lookup_table.find(id);
+        if (itr == id_lookup_table.end())
+            return 0;
+
+        BindingList* list = bindings.Find(itr->second);
+        if (!list)
+            return 0;
+
+        for (Binding& binding : list->bindings)
+        {
+            if (binding.id != id)
+                continue;
+
+            // an array pushed before the quarantine can still call the binding
+            if (binding.quarantinedUntil)
+                return 0;
+
+            uint32 now = ElunaUtil::GetCurrTime();
+            if (!binding.errors || now - binding.errorWindowStart > window)
+            {
+                binding.errors = 0;
+                binding.errorWindowStart = now;
+            }
+
+            if (++binding.errors < maxErrors)
+                return 0;
+
+            uint32 duration = quarantineTime << std::min<uint32>(binding.quarantines, 6);
+            binding.errors = 0;
+            ++binding.quarantines;
+            SetQuarantine(*list, binding, (now + duration) ? now + duration : 1);
+            return duration;
+        }
+
+        return 0;
+    }
+
+    /*
+     * Calls `f(event_id, binding)` for every quarantined binding.
+     */
+    template<typename F>
+    void ForEachQuarantined(F&& f)
+    {
+        bindings.ForEach([&](BindingList& list)
+        {
+            if (!list.quarantinedBindings)
+                return;
+
+            for (const Binding& binding : list.bindings)
+                if (binding.quarantinedUntil)
+                    f(id_lookup_table.at(binding.id).event_id, binding);
+        });
+    }
+
+    /*
+     * Release the quarantined binding `id`, or every quarantined binding if `id` is 0.
+     *
+     * Released bindings start over with the shortest quarantine. Returns the number of released bindings.
+     */
+    uint32 ReleaseQuarantines(uint64 id = 0)
+    {
+        uint32 released = 0;
+        bindings.ForEach([&](BindingList& list)
+        {
+            if (!list.quarantinedBindings)
+                return;
+
+            for (Binding& binding : list.bindings)
+            {
+                if (!binding.quarantinedUntil || (id && binding.id != id))
+                    continue;
+
+                binding.errors = 0;
+                binding.quarantines = 0;
+                SetQuarantine(list, binding, 0);
+                ++released;
+            }
+        });
+        return released;
+    }
+
+private:
+    /*
+     * Count down the shots of `list`, dropping bindings that ran out of shots.
+     *
+     * The array pushed for this call still holds them, so they run one last time.
+     */
+    void CountDownShots(const K& key, BindingList& list)
+    {
+        // Compact the list in place, dropping bindings that ran out of shots.
+        size_t kept = 0;
+        for (size_t i = 0; i < list.bindings.size(); ++i)
+        {
+            Binding& binding = list.bindings[i];
+
+            // quarantined bindings are not called, so they keep their shots
+            if (binding.remainingShots > 0 && !binding.quarantinedUntil)
+            {
+                binding.remainingShots -= 1;
+
+                if (binding.remainingShots == 0)
+                {
+                    id_lookup_table.erase(binding.id);
+                    Unref(binding);
+                    --list.limitedBindings;
+                    continue;
+                }
+            }
+
+            if (kept != i)
+                list.bindings[kept] = binding;
+            ++kept;
+        }
+
+        if (kept == list.bindings.size())
+            return;
+
+        RemoveHandlers(key.event_id, static_cast<uint32>(list.bindings.size() - kept));
+        list.bindings.resize(kept);
+        InvalidateHandlers(list);
+        if (list.empty())
+            bindings.Erase(key);
+    }
+};
+
 #endif // _BINDING_MAP_H
@@ -0,0 +1,182 @@
+/*
+* Copyright (C) 2010 - 2025 Eluna Lua Engine <https://elunaluaengine.github.io/>
+* This program is free software licensed under GPL version 3
+* Please see the included DOCS/LICENSE.md for more information
+*/
+
+#include "ElunaAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Classes are 16 bytes apart up to 128 bytes and 32 bytes apart up to 256 bytes
+size_t ElunaAllocator::ClassIndex(size_t size)
+{
+    size_t granules = (size + GRANULE - 1) / GRANULE;
+    if (granules <= 8)
+        return granules - 1;
+    return 8 + (granules - 9) / 2;
+}
+
+size_t ElunaAllocator::ClassSize(size_t index)
+{
+    if (index < 8)
+        return (index + 1) * GRANULE;
+    return 128 + (index - 7) * 2 * GRANULE;
+}
+
+void* ElunaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    // without a block, Lua 5.4 passes the type of the new object as the old size
+    return static_cast<ElunaAllocator*>(ud)->Reallocate(ptr, ptr ? osize : 0, nsize);
+}
+
+void* ElunaAllocator::Reallocate(void* ptr, size_t osize, size_t nsize)
+{
+    if (nsize == 0)
+    {
+        if (ptr)
+        {
+            if (osize <= MAX_SMALL_SIZE)
+                FreeSmall(ptr, ClassIndex(osize));
+            else
+                std::free(ptr);
+            RemoveLive(osize);
+        }
+        return nullptr;
+    }
+
+    // growing over the hard limit fails, Lua 5.2 and newer then run an emergency collection before raising a memory error.
+    // Outside of a protected call the memory error would reach the panic handler, so the allocation is allowed
+    uint64 hard = hardLimit.load(std::memory_order_relaxed);
+    if (hard && protectedCalls && nsize > osize && live.load(std::memory_order_relaxed) + (nsize - osize) > hard)
+    {
+        failedAllocations.store(failedAllocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void* block;
+    if (nsize <= MAX_SMALL_SIZE)
+    {
+        size_t index = ClassIndex(nsize);
+        if (ptr && osize <= MAX_SMALL_SIZE && ClassIndex(osize) == index)
+            block = ptr;
+        else
+        {
+            block = AllocateSmall(index);
+            if (!block)
+                return nullptr;
+
+            if (ptr)
+            {
+                std::memcpy(block, ptr, std::min(osize, nsize));
+                if (osize <= MAX_SMALL_SIZE)
+                    FreeSmall(ptr, ClassIndex(osize));
+                else
+                    std::free(ptr);
+            }
+        }
+    }
+    else if (ptr && osize > MAX_SMALL_SIZE)
+    {
+        block = std::realloc(ptr, nsize);
+        if (!block)
+            return nullptr;
+    }
+    else
+    {
+        block = std::malloc(nsize);
+        if (!block)
+            return nullptr;
+
+        if (ptr)
+        {
+            std::memcpy(block, ptr, osize);
+            FreeSmall(ptr, ClassIndex(osize));
+        }
+    }
+
+    if (nsize > osize)
+        AddLive(nsize - osize);
+    else
+        RemoveLive(osize - nsize);
+    return block;
+}
+
+void* ElunaAllocator::AllocateSmall(size_t index)
+{
+    size_t size = ClassSize(index);
+    uint64 pooledSize = pooled.load(std::memory_order_relaxed);
+
+    if (FreeBlock* block = freeLists[index])
+    {
+        freeLists[index] = block->next;
+        pooled.store(pooledSize - size, std::memory_order_relaxed);
+        return block;
+    }
+
+    if (size_t(chunkEnd - chunkPos) < size)
+    {
+        std::unique_ptr<unsigned char[]> chunk(new (std::nothrow) unsigned char[CHUNK_SIZE]);
+        if (!chunk)
+            return nullptr;
+
+        // the end of the previous chunk is too small for this class and is left unused
+        pooledSize -= chunkEnd - chunkPos;
+        pooledSize += CHUNK_SIZE;
+        chunkPos = chunk.get();
+        chunkEnd = chunkPos + CHUNK_SIZE;
+        chunks.push_back(std::move(chunk));
+    }
+
+    void* block = chunkPos;
+    chunkPos += size;
+    pooled.store(pooledSize - size, std::memory_order_relaxed);
+    return block;
+}
+
+void ElunaAllocator::FreeSmall(void* ptr, size_t index)
+{
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = freeLists[index];
+    freeLists[index] = block;
+    pooled.store(pooled.load(std::memory_order_relaxed) + ClassSize(index), std::memory_order_relaxed);
+}
+
+void ElunaAllocator::AddLive(uint64 size)
+{
+    uint64 value = live.load(std::memory_order_relaxed) + size;
+    live.store(value, std::memory_order_relaxed);
+    if (value > peak.load(std::memory_order_relaxed))
+        peak.store(value, std::memory_order_relaxed);
+
+    uint64 soft = softLimit.load(std::memory_order_relaxed);
+    if (soft && value > soft && value - size <= soft)
+        softLimitReached.store(true, std::memory_order_relaxed);
+}
+
+void ElunaAllocator::RemoveLive(uint64 size)
+{
+    live.store(live.load(std::memory_order_relaxed) - size, std::memory_order_relaxed);
+}
+
+void ElunaAllocator::SetLimits(uint64 soft, uint64 hard)
+{
+    softLimit.store(soft, std::memory_order_relaxed);
+    hardLimit.store(hard, std::memory_order_relaxed);
+    softLimitReached.store(soft && live.load(std::memory_order_relaxed) > soft, std::memory_order_relaxed);
+}
+
+ElunaMemoryStats ElunaAllocator::GetStats() const
+{
+    ElunaMemoryStats stats;
+    stats.live = live.load(std::memory_order_relaxed);
+    stats.peak = peak.load(std::memory_order_relaxed);
+    stats.pooled = pooled.load(std::memory_order_relaxed);
+    stats.softLimit = softLimit.load(std::memory_order_relaxed);
+    stats.hardLimit = hardLimit.load(std::memory_order_relaxed);
+    stats.failedAllocations = failedAllocations.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,86 @@
+/*
+* Copyright (C) 2010 - 2025 Eluna Lua Engine <https://elunaluaengine.github.io/>
+* This program is free software licensed under GPL version 3
+* Please see the included DOCS/LICENSE.md for more information
+*/
+
+#ifndef _ELUNA_ALLOCATOR_H
+#define _ELUNA_ALLOCATOR_H
+
+#include "ElunaUtility.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct ElunaMemoryStats
+{
+    uint64 live = 0;       // Bytes currently allocated by the Lua state
+    uint64 peak = 0;       // Most bytes allocated at once
+    uint64 pooled = 0;     // Bytes held by the small block free lists and chunks for reuse
+    uint64 softLimit = 0;  // Bytes after which a full garbage collection is run, 0 for no limit
+    uint64 hardLimit = 0;  // Bytes after which allocations fail, 0 for no limit
+    uint64 failedAllocations = 0; // Allocations refused because of the hard limit
+};
+
+// Allocator of one Lua state, small blocks come from size class free lists and all blocks are counted.
+// Only the thread running the state allocates, the counters can be read from any thread.
+class ElunaAllocator
+{
+public:
+    ElunaAllocator() { }
+
+    ElunaAllocator(ElunaAllocator const&) = delete;
+    ElunaAllocator& operator=(ElunaAllocator const&) = delete;
+
+    // lua_Alloc function, `ud` is the ElunaAllocator
+    static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    // Limits in bytes, 0 for no limit
+    void SetLimits(uint64 soft, uint64 hard);
+    // The hard limit only applies between these calls, made around protected calls into Lua.
+    // Outside of one a failed allocation would raise an error without a handler and abort the process
+    void EnterProtectedCall() { ++protectedCalls; }
+    void LeaveProtectedCall() { --protectedCalls; }
+    // True once each time the allocated memory goes over the soft limit
+    bool TakeSoftLimitReached() { return softLimitReached.exchange(false, std::memory_order_relaxed); }
+
+    ElunaMemoryStats GetStats() const;
+
+private:
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_SMALL_SIZE = 256;
+    static constexpr size_t CLASS_COUNT = 12;
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static size_t ClassIndex(size_t size);
+    static size_t ClassSize(size_t index);
+
+    void* Reallocate(void* ptr, size_t osize, size_t nsize);
+    void* AllocateSmall(size_t index);
+    void FreeSmall(void* ptr, size_t index);
+    void AddLive(uint64 size);
+    void RemoveLive(uint64 size);
+
+    FreeBlock* freeLists[CLASS_COUNT] = { };
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    unsigned char* chunkPos = nullptr;
+    unsigned char* chunkEnd = nullptr;
+    uint32 protectedCalls = 0;
+
+    // written only by the thread running the state
+    std::atomic<uint64> live { 0 };
+    std::atomic<uint64> peak { 0 };
+    std::atomic<uint64> pooled { 0 };
+    std::atomic<uint64> failedAllocations { 0 };
+    std::atomic<uint64> softLimit { 0 };
+    std::atomic<uint64> hardLimit { 0 };
+    std::atomic<bool> softLimitReached { false };
+};
+
+#endif
@@ -38,18 +38,39 @@ void ElunaConfig::Initialize()
     SetConfig(CONFIG_ELUNA_ENABLE_UNSAFE, "Eluna.UseUnsafeMethods", true);
     SetConfig(CONFIG_ELUNA_ENABLE_DEPRECATED, "Eluna.UseDeprecatedMethods", true);
     SetConfig(CONFIG_ELUNA_ENABLE_RELOAD_COMMAND, "Eluna.ReloadCommand", true);
+    SetConfig(CONFIG_ELUNA_USERDATA_CACHE, "Eluna.UserdataCache", false);
+    SetConfig(CONFIG_ELUNA_INCREMENTAL_RELOAD, "Eluna.IncrementalReload", true);
+    SetConfig(CONFIG_ELUNA_BACKGROUND_RELOAD, "Eluna.BackgroundReload", false);
+    SetConfig(CONFIG_ELUNA_STRIP_BYTECODE, "Eluna.StripBytecode", false);
+    SetConfig(CONFIG_ELUNA_GC_GENERATIONAL, "Eluna.GCGenerational", false);
 
     // Load strings
     SetConfig(CONFIG_ELUNA_SCRIPT_PATH, "Eluna.ScriptPath", "lua_scripts");
     SetConfig(CONFIG_ELUNA_ONLY_ON_MAPS, "Eluna.OnlyOnMaps", "");
     SetConfig(CONFIG_ELUNA_REQUIRE_PATH_EXTRA, "Eluna.RequirePaths", "");
     SetConfig(CONFIG_ELUNA_REQUIRE_CPATH_EXTRA, "Eluna.RequireCPaths", "");
+    SetConfig(CONFIG_ELUNA_BYTECODE_CACHE_PATH, "Eluna.BytecodeCachePath", "");
+    SetConfig(CONFIG_ELUNA_DEBUG_INFO_SCRIPTS, "Eluna.DebugInfoScripts", "");
 
     // Load ints
     SetConfig(CONFIG_ELUNA_RELOAD_SECURITY_LEVEL, "Eluna.ReloadSecurityLevel", 3);
+    SetConfig(CONFIG_ELUNA_COMPILE_THREADS, "Eluna.CompileThreads", 0);
+    SetConfig(CONFIG_ELUNA_BYTECODE_CACHE_SIZE, "Eluna.BytecodeCacheSize", 128);
+    SetConfig(CONFIG_ELUNA_JIT_OPT_LEVEL, "Eluna.JitOptLevel", 3);
+    SetConfig(CONFIG_ELUNA_LOAD_REPORT_SIZE, "Eluna.LoadReportSize", 0);
+    SetConfig(CONFIG_ELUNA_MEMORY_SOFT_LIMIT, "Eluna.MemorySoftLimit", 0);
+    SetConfig(CONFIG_ELUNA_MEMORY_HARD_LIMIT, "Eluna.MemoryHardLimit", 0);
+    SetConfig(CONFIG_ELUNA_GC_STEP_BUDGET, "Eluna.GCStepBudget", 0);
+    SetConfig(CONFIG_ELUNA_WATCHDOG_CALL_TIME, "Eluna.WatchdogCallTime", 0);
+    SetConfig(CONFIG_ELUNA_WATCHDOG_LOAD_TIME, "Eluna.WatchdogLoadTime", 0);
+    SetConfig(CONFIG_ELUNA_QUARANTINE_ERRORS, "Eluna.QuarantineErrors", 0);
+    SetConfig(CONFIG_ELUNA_QUARANTINE_WINDOW, "Eluna.QuarantineWindow", 10000);
+    SetConfig(CONFIG_ELUNA_QUARANTINE_TIME, "Eluna.QuarantineTime", 60000);
+    SetConfig(CONFIG_ELUNA_ERROR_LOG_INTERVAL, "Eluna.ErrorLogInterval", 0);
 
     // Call extra functions
     TokenizeAllowedMaps();
+    TokenizeDebugInfoScripts();
 }
 
 void ElunaConfig::SetConfig(ElunaConfigBoolValues index, char const* fieldname, bool defvalue)
@@ -97,6 +118,15 @@ bool ElunaConfig::ShouldMapLoadEluna(uint32 id)
     return (m_allowedMaps.find(id) != m_allowedMaps.end());
 }
 
+bool ElunaConfig::ShouldStripBytecode(const std::string& filename)
+{
+    if (!GetConfig(CONFIG_ELUNA_STRIP_BYTECODE))
+        return false;
+
+    // scripts in the list keep their debug info for line numbers in errors
+    return m_debugInfoScripts.find(filename) == m_debugInfoScripts.end();
+}
+
 void ElunaConfig::TokenizeAllowedMaps()
 {
     // clear allowed maps
@@ -123,3 +153,22 @@ void ElunaConfig::TokenizeAllowedMaps()
         }
     }
 }
+
+void ElunaConfig::TokenizeDebugInfoScripts()
+{
+    m_debugInfoScripts.clear();
+
+    std::istringstream scripts(GetConfig(CONFIG_ELUNA_DEBUG_INFO_SCRIPTS));
+
+    // script file names without extension, like require uses them
+    std::string filename;
+    while (std::getline(scripts, filename, ','))
+    {
+        filename.erase(std::remove_if(filename.begin(), filename.end(), [](char c) {
+            return std::isspace(static_cast<unsigned char>(c));
+            }), filename.end());
+
+        if (!filename.empty())
+            m_debugInfoScripts.emplace(filename);
+    }
+}
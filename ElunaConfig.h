@@ -17,6 +17,11 @@ enum ElunaConfigBoolValues
     CONFIG_ELUNA_ENABLE_UNSAFE,
     CONFIG_ELUNA_ENABLE_DEPRECATED,
     CONFIG_ELUNA_ENABLE_RELOAD_COMMAND,
+    CONFIG_ELUNA_USERDATA_CACHE,
+    CONFIG_ELUNA_INCREMENTAL_RELOAD,
+    CONFIG_ELUNA_BACKGROUND_RELOAD,
+    CONFIG_ELUNA_STRIP_BYTECODE,
+    CONFIG_ELUNA_GC_GENERATIONAL,
     CONFIG_ELUNA_BOOL_COUNT
 };
 
@@ -26,12 +31,27 @@ enum ElunaConfigStringValues
     CONFIG_ELUNA_ONLY_ON_MAPS,
     CONFIG_ELUNA_REQUIRE_PATH_EXTRA,
     CONFIG_ELUNA_REQUIRE_CPATH_EXTRA,
+    CONFIG_ELUNA_BYTECODE_CACHE_PATH,
+    CONFIG_ELUNA_DEBUG_INFO_SCRIPTS,
     CONFIG_ELUNA_STRING_COUNT
 };
 
 enum ElunaConfigUInt32Values
 {
     CONFIG_ELUNA_RELOAD_SECURITY_LEVEL,
+    CONFIG_ELUNA_COMPILE_THREADS,
+    CONFIG_ELUNA_BYTECODE_CACHE_SIZE,
+    CONFIG_ELUNA_JIT_OPT_LEVEL,
+    CONFIG_ELUNA_LOAD_REPORT_SIZE,
+    CONFIG_ELUNA_MEMORY_SOFT_LIMIT,
+    CONFIG_ELUNA_MEMORY_HARD_LIMIT,
+    CONFIG_ELUNA_GC_STEP_BUDGET,
+    CONFIG_ELUNA_WATCHDOG_CALL_TIME,
+    CONFIG_ELUNA_WATCHDOG_LOAD_TIME,
+    CONFIG_ELUNA_QUARANTINE_ERRORS,
+    CONFIG_ELUNA_QUARANTINE_WINDOW,
+    CONFIG_ELUNA_QUARANTINE_TIME,
+    CONFIG_ELUNA_ERROR_LOG_INTERVAL,
     CONFIG_ELUNA_INT_COUNT
 };
 
@@ -56,8 +76,11 @@ public:
     bool UnsafeMethodsEnabled() { return GetConfig(CONFIG_ELUNA_ENABLE_UNSAFE); }
     bool DeprecatedMethodsEnabled() { return GetConfig(CONFIG_ELUNA_ENABLE_DEPRECATED); }
     bool IsReloadCommandEnabled() { return GetConfig(CONFIG_ELUNA_ENABLE_RELOAD_COMMAND); }
+    bool IsUserdataCacheEnabled() { return GetConfig(CONFIG_ELUNA_USERDATA_CACHE); }
+    bool IsBackgroundReloadEnabled() { return GetConfig(CONFIG_ELUNA_BACKGROUND_RELOAD); }
     AccountTypes GetReloadSecurityLevel() { return static_cast<AccountTypes>(GetConfig(CONFIG_ELUNA_RELOAD_SECURITY_LEVEL)); }
     bool ShouldMapLoadEluna(uint32 mapId);
+    bool ShouldStripBytecode(const std::string& filename);
 
 private:
     bool _configBoolValues[CONFIG_ELUNA_BOOL_COUNT];
@@ -73,8 +96,10 @@ private:
     void SetConfig(ElunaConfigUInt32Values index, char const* fieldname, uint32 defvalue);
 
     void TokenizeAllowedMaps();
+    void TokenizeDebugInfoScripts();
 
     std::unordered_set<uint32> m_allowedMaps;
+    std::unordered_set<std::string> m_debugInfoScripts;
 };
 
 #define sElunaConfig ElunaConfig::instance()
@@ -12,6 +12,10 @@
 #include "Entities/Object.h"
 #endif
 
+#include <algorithm>
+#include <functional>
+#include <new>
+
 extern "C"
 {
 #include "lua.h"
@@ -23,16 +27,15 @@ ElunaEventProcessor::~ElunaEventProcessor()
     ClearAllEvents();
 }
 
-void ElunaEventProcessor::Update(uint32 diff)
+void ElunaEventProcessor::Update()
 {
     isUpdating = true;
 
-    m_time += diff;
-    while (!eventList.empty() && eventList.begin()->first <= m_time)
+    uint64 now = mgr->m_time;
+    while (!eventList.empty() && eventList.front()->dueTime <= now)
     {
-        auto it = eventList.begin();
-        LuaEvent* luaEvent = it->second;
-        eventList.erase(it);
+        LuaEvent* luaEvent = eventList.front();
+        HeapErase(luaEvent);
 
         if (luaEvent->state != LUAEVENT_STATE_ERASE)
             eventMap.erase(luaEvent->funcRef);
@@ -58,6 +61,9 @@ void ElunaEventProcessor::Update(uint32 diff)
 
     isUpdating = false;
     ProcessDeferredOps();
+
+    if (!eventList.empty())
+        mgr->ScheduleProcessor(this, eventList.front()->dueTime);
 }
 
 void ElunaEventProcessor::SetStates(LuaEventState state)
@@ -68,11 +74,19 @@ void ElunaEventProcessor::SetStates(LuaEventState state)
         return;
     }
 
-    for (auto& [time, event] : eventList)
-        event->SetState(state);
+    if (state == LUAEVENT_STATE_RUN)
+        return;
+
+    // not updating, so the events can be removed right away instead of when they are due
+    EventList events;
+    events.swap(eventList);
+    eventMap.clear();
 
-    if (state == LUAEVENT_STATE_ERASE)
-        eventMap.clear();
+    for (LuaEvent* event : events)
+    {
+        event->SetState(state);
+        RemoveEvent(event);
+    }
 }
 
 void ElunaEventProcessor::ClearAllEvents()
@@ -83,9 +97,14 @@ void ElunaEventProcessor::ClearAllEvents()
         return;
     }
 
-    for (auto& [time, event] : eventList)
+    for (LuaEvent* event : eventList)
         RemoveEvent(event);
 
+    // events waiting to be added back are owned by the queued ops
+    for (DeferredOp& op : deferredOps)
+        if (op.type == DeferredOpType::AddEvent)
+            RemoveEvent(op.event);
+
     deferredOps.clear();
     eventList.clear();
     eventMap.clear();
@@ -100,11 +119,18 @@ void ElunaEventProcessor::SetState(int eventId, LuaEventState state)
     }
 
     auto itr = eventMap.find(eventId);
-    if (itr != eventMap.end())
-        itr->second->SetState(state);
+    if (itr == eventMap.end())
+        return;
+
+    LuaEvent* luaEvent = itr->second;
+    luaEvent->SetState(state);
+    if (luaEvent->state == LUAEVENT_STATE_RUN)
+        return;
 
-    if (state == LUAEVENT_STATE_ERASE)
-        eventMap.erase(eventId);
+    // not updating, so the event can be removed right away instead of when it is due
+    eventMap.erase(itr);
+    HeapErase(luaEvent);
+    RemoveEvent(luaEvent);
 }
 
 void ElunaEventProcessor::AddEvent(LuaEvent* luaEvent)
@@ -116,13 +142,18 @@ void ElunaEventProcessor::AddEvent(LuaEvent* luaEvent)
     }
 
     luaEvent->GenerateDelay();
-    eventList.emplace(m_time + luaEvent->delay, luaEvent);
+    luaEvent->dueTime = mgr->m_time + luaEvent->delay;
+    luaEvent->sequence = m_sequence++;
+    HeapPush(luaEvent);
     eventMap[luaEvent->funcRef] = luaEvent;
+
+    if (luaEvent->heapIndex == 0)
+        mgr->ScheduleProcessor(this, luaEvent->dueTime);
 }
 
 void ElunaEventProcessor::AddEvent(int funcRef, uint32 min, uint32 max, uint32 repeats)
 {
-    AddEvent(new LuaEvent(funcRef, min, max, repeats));
+    AddEvent(mgr->eventPool.Allocate(funcRef, min, max, repeats));
 }
 
 void ElunaEventProcessor::RemoveEvent(LuaEvent* luaEvent)
@@ -133,7 +164,87 @@ void ElunaEventProcessor::RemoveEvent(LuaEvent* luaEvent)
         // Free lua function ref
         luaL_unref(mgr->E->L, LUA_REGISTRYINDEX, luaEvent->funcRef);
     }
-    delete luaEvent;
+    mgr->eventPool.Free(luaEvent);
+}
+
+bool ElunaEventProcessor::RunsBefore(LuaEvent const* a, LuaEvent const* b)
+{
+    if (a->dueTime != b->dueTime)
+        return a->dueTime < b->dueTime;
+    return a->sequence < b->sequence;
+}
+
+void ElunaEventProcessor::HeapPush(LuaEvent* luaEvent)
+{
+    luaEvent->heapIndex = static_cast<uint32>(eventList.size());
+    eventList.push_back(luaEvent);
+    HeapSiftUp(luaEvent->heapIndex);
+}
+
+void ElunaEventProcessor::HeapErase(LuaEvent* luaEvent)
+{
+    uint32 index = luaEvent->heapIndex;
+    ASSERT(index < eventList.size() && eventList[index] == luaEvent);
+
+    LuaEvent* last = eventList.back();
+    eventList.pop_back();
+    if (last == luaEvent)
+        return;
+
+    // move the last event into the hole and restore the heap order around it
+    eventList[index] = last;
+    last->heapIndex = index;
+    if (index > 0 && RunsBefore(last, eventList[(index - 1) / 4]))
+        HeapSiftUp(index);
+    else
+        HeapSiftDown(index);
+}
+
+void ElunaEventProcessor::HeapSiftUp(uint32 index)
+{
+    LuaEvent* luaEvent = eventList[index];
+    while (index > 0)
+    {
+        uint32 parent = (index - 1) / 4;
+        if (!RunsBefore(luaEvent, eventList[parent]))
+            break;
+
+        eventList[index] = eventList[parent];
+        eventList[index]->heapIndex = index;
+        index = parent;
+    }
+
+    eventList[index] = luaEvent;
+    luaEvent->heapIndex = index;
+}
+
+void ElunaEventProcessor::HeapSiftDown(uint32 index)
+{
+    LuaEvent* luaEvent = eventList[index];
+    uint32 size = static_cast<uint32>(eventList.size());
+    while (true)
+    {
+        uint32 first = index * 4 + 1;
+        if (first >= size)
+            break;
+
+        // find the earliest of up to four children
+        uint32 best = first;
+        uint32 last = std::min(first + 4, size);
+        for (uint32 child = first + 1; child < last; ++child)
+            if (RunsBefore(eventList[child], eventList[best]))
+                best = child;
+
+        if (!RunsBefore(eventList[best], luaEvent))
+            break;
+
+        eventList[index] = eventList[best];
+        eventList[index]->heapIndex = index;
+        index = best;
+    }
+
+    eventList[index] = luaEvent;
+    luaEvent->heapIndex = index;
 }
 
 void ElunaEventProcessor::QueueDeferredOp(DeferredOpType type, LuaEvent* event, int eventId, LuaEventState state)
@@ -151,8 +262,7 @@ void ElunaEventProcessor::ProcessDeferredOps()
     if (deferredOps.empty())
         return;
 
-    std::vector<DeferredOp> ops;
-    ops.swap(deferredOps);
+    processingOps.swap(deferredOps);
 
     using Handler = void(*)(ElunaEventProcessor*, DeferredOp&);
     static constexpr Handler handlers[] =
@@ -163,10 +273,42 @@ void ElunaEventProcessor::ProcessDeferredOps()
         [](ElunaEventProcessor* self, DeferredOp& /*op*/) { self->ClearAllEvents(); }
     };
 
-    for (DeferredOp& op : ops)
+    for (DeferredOp& op : processingOps)
     {
         handlers[op.type](this, op);
     }
+
+    processingOps.clear();
+}
+
+LuaEvent* ElunaEventPool::Allocate(int funcRef, uint32 min, uint32 max, uint32 repeats)
+{
+    if (freeSlots.empty())
+    {
+        slabs.emplace_back(new Slot[SLAB_SIZE]);
+        Slot* slab = slabs.back().get();
+        for (uint32 i = SLAB_SIZE; i > 0; --i)
+            freeSlots.push_back(&slab[i - 1]);
+        stats.capacity += SLAB_SIZE;
+    }
+
+    Slot* slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    ++stats.allocs;
+    if (++stats.live > stats.peak)
+        stats.peak = stats.live;
+
+    return new (slot->data) LuaEvent(funcRef, min, max, repeats);
+}
+
+void ElunaEventPool::Free(LuaEvent* luaEvent)
+{
+    luaEvent->~LuaEvent();
+    freeSlots.push_back(reinterpret_cast<Slot*>(luaEvent));
+
+    ++stats.frees;
+    --stats.live;
 }
 
 ElunaProcessorInfo::~ElunaProcessorInfo()
@@ -175,10 +317,10 @@ ElunaProcessorInfo::~ElunaProcessorInfo()
         mgr->FlagObjectProcessorForDeletion(processorId);
 }
 
-EventMgr::EventMgr(Eluna* _E) : E(_E)
+EventMgr::EventMgr(Eluna* _E) : m_time(0), E(_E)
 {
     auto gp = std::make_unique<ElunaEventProcessor>(this, nullptr);
-    processors.insert(gp.get());
+    AddProcessor(gp.get());
     globalProcessors.emplace(GLOBAL_EVENTS, std::move(gp));
 }
 
@@ -186,35 +328,124 @@ EventMgr::~EventMgr()
 {
     globalProcessors.clear();
     objectProcessors.clear();
-    processors.clear();
+    processorSlots.clear();
+    wakeups.clear();
     objectProcessorsPendingDelete.clear();
 }
 
 void EventMgr::UpdateProcessors(uint32 diff)
 {
-    // iterate a copy because processors may be destroyed during update (creature removed by a script, etc)
-    ProcessorSet copy = processors;
+    m_time += diff;
 
-    for (auto* processor : copy)
+    // take out the wakeups that are due first, processors scheduled while updating run on the next tick
+    while (!wakeups.empty() && wakeups.front().time <= m_time)
     {
-        if (processors.find(processor) != processors.end())
-            if (!processor->pendingDeletion)
-                processor->Update(diff);
+        std::pop_heap(wakeups.begin(), wakeups.end(), std::greater<ProcessorWakeup>());
+        dueWakeups.push_back(wakeups.back());
+        wakeups.pop_back();
     }
 
+    for (ProcessorWakeup const& wakeup : dueWakeups)
+    {
+        // the slot generation changes when the processor is destroyed, so stale wakeups are skipped
+        ProcessorSlot const& slot = processorSlots[wakeup.slot];
+        if (slot.generation != wakeup.generation)
+            continue;
+
+        ElunaEventProcessor* processor = slot.processor;
+        if (processor->wakeTime != wakeup.time)
+            continue;
+
+        processor->wakeTime = UINT64_MAX;
+        if (!processor->pendingDeletion)
+            processor->Update();
+    }
+
+    dueWakeups.clear();
+
     CleanupObjectProcessors();
 }
 
 void EventMgr::SetAllEventStates(LuaEventState state)
 {
-    for (auto* processor : processors)
-        processor->SetStates(state);
+    for (ProcessorSlot const& slot : processorSlots)
+        if (slot.processor)
+            slot.processor->SetStates(state);
 }
 
 void EventMgr::SetEventState(int eventId, LuaEventState state)
 {
-    for (auto* processor : processors)
-        processor->SetState(eventId, state);
+    for (ProcessorSlot const& slot : processorSlots)
+        if (slot.processor)
+            slot.processor->SetState(eventId, state);
+}
+
+void EventMgr::MoveGlobalEvents(EventMgr& from)
+{
+    for (auto& [space, fromProcessor] : from.globalProcessors)
+    {
+        ElunaEventProcessor* toProcessor = GetGlobalProcessor(space);
+        if (!toProcessor)
+            continue;
+
+        ElunaEventProcessor::EventList events;
+        events.swap(fromProcessor->eventList);
+        fromProcessor->eventMap.clear();
+        std::sort(events.begin(), events.end(), &ElunaEventProcessor::RunsBefore);
+
+        for (LuaEvent* event : events)
+        {
+            LuaEvent* moved = eventPool.Allocate(event->funcRef, event->min, event->max, event->repeats);
+            moved->delay = event->delay;
+            moved->dueTime = m_time + (event->dueTime > from.m_time ? event->dueTime - from.m_time : 0);
+            moved->sequence = toProcessor->m_sequence++;
+            toProcessor->HeapPush(moved);
+            toProcessor->eventMap[moved->funcRef] = moved;
+
+            // the function reference now belongs to the moved event
+            event->SetState(LUAEVENT_STATE_ERASE);
+            fromProcessor->RemoveEvent(event);
+        }
+
+        if (!toProcessor->eventList.empty())
+            ScheduleProcessor(toProcessor, toProcessor->eventList.front()->dueTime);
+    }
+}
+
+void EventMgr::AddProcessor(ElunaEventProcessor* processor)
+{
+    if (freeProcessorSlots.empty())
+    {
+        processor->slot = static_cast<uint32>(processorSlots.size());
+        processorSlots.emplace_back();
+    }
+    else
+    {
+        processor->slot = freeProcessorSlots.back();
+        freeProcessorSlots.pop_back();
+    }
+
+    processorSlots[processor->slot].processor = processor;
+}
+
+void EventMgr::RemoveProcessor(ElunaEventProcessor* processor)
+{
+    ProcessorSlot& slot = processorSlots[processor->slot];
+    slot.processor = nullptr;
+    ++slot.generation;
+    freeProcessorSlots.push_back(processor->slot);
+}
+
+void EventMgr::ScheduleProcessor(ElunaEventProcessor* processor, uint64 time)
+{
+    // an earlier or equal wakeup is already queued and the processor reschedules itself after updating
+    if (time >= processor->wakeTime)
+        return;
+
+    // any later wakeup left in the heap no longer matches wakeTime and is skipped when it comes due
+    processor->wakeTime = time;
+    wakeups.push_back({ time, processor->slot, processorSlots[processor->slot].generation });
+    std::push_heap(wakeups.begin(), wakeups.end(), std::greater<ProcessorWakeup>());
 }
 
 ElunaEventProcessor* EventMgr::GetGlobalProcessor(GlobalEventSpace space)
@@ -231,9 +462,7 @@ uint64 EventMgr::CreateObjectProcessor(WorldObject* obj)
     uint64 id = obj->GetObjectGuid().GetRawValue();
 #endif
     auto proc = std::make_unique<ElunaEventProcessor>(this, obj);
-    ElunaEventProcessor* raw = proc.get();
-
-    processors.insert(raw);
+    AddProcessor(proc.get());
     objectProcessors.emplace(id, std::move(proc));
 
     return id;
@@ -271,7 +500,7 @@ void EventMgr::CleanupObjectProcessors()
         ElunaEventProcessor* p = it->second.get();
         p->SetStates(LUAEVENT_STATE_ERASE);
 
-        processors.erase(p);
+        RemoveProcessor(p);
         objectProcessors.erase(it);
     }
 
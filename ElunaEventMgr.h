@@ -16,7 +16,7 @@
 #else
 #include "Util.h"
 #endif
-#include <map>
+#include <vector>
 
 #if defined ELUNA_TRINITY || defined ELUNA_AZEROTHCORE
 #include "Define.h"
@@ -51,7 +51,7 @@ enum GlobalEventSpace : uint8
 
 struct LuaEvent
 {
-    LuaEvent(int _funcRef, uint32 _min, uint32 _max, uint32 _repeats) : min(_min), max(_max), delay(0), repeats(_repeats), funcRef(_funcRef), state(LUAEVENT_STATE_RUN) { }
+    LuaEvent(int _funcRef, uint32 _min, uint32 _max, uint32 _repeats) : min(_min), max(_max), delay(0), repeats(_repeats), funcRef(_funcRef), state(LUAEVENT_STATE_RUN), dueTime(0), sequence(0), heapIndex(0) { }
 
     void SetState(LuaEventState _state)
     {
@@ -70,6 +70,46 @@ struct LuaEvent
     uint32 repeats; // Amount of repeats to make, 0 for infinite
     int funcRef;    // Lua function reference ID, also used as event ID
     LuaEventState state;    // State for next call
+
+    uint64 dueTime;   // Processor time at which the event runs next
+    uint64 sequence;  // Scheduling order, runs events due at the same time in the order they were added
+    uint32 heapIndex; // Position in the owning processor's event heap
+};
+
+struct ElunaEventPoolStats
+{
+    uint32 live = 0;     // Events currently allocated
+    uint32 peak = 0;     // Most events allocated at once
+    uint32 capacity = 0; // Events the allocated slabs can hold
+    uint64 allocs = 0;   // Total allocations
+    uint64 frees = 0;    // Total frees
+};
+
+// Slab allocator for the timed events of one EventMgr, freed events are reused before a new slab is allocated
+class ElunaEventPool
+{
+public:
+    ElunaEventPool() { }
+
+    ElunaEventPool(ElunaEventPool const&) = delete;
+    ElunaEventPool& operator=(ElunaEventPool const&) = delete;
+
+    LuaEvent* Allocate(int funcRef, uint32 min, uint32 max, uint32 repeats);
+    void Free(LuaEvent* luaEvent);
+
+    ElunaEventPoolStats const& GetStats() const { return stats; }
+
+private:
+    static constexpr uint32 SLAB_SIZE = 64;
+
+    struct alignas(LuaEvent) Slot
+    {
+        unsigned char data[sizeof(LuaEvent)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    std::vector<Slot*> freeSlots;
+    ElunaEventPoolStats stats;
 };
 
 class ElunaEventProcessor
@@ -77,16 +117,17 @@ class ElunaEventProcessor
     friend class EventMgr;
 
 public:
-    typedef std::multimap<uint64, LuaEvent*> EventList;
+    typedef std::vector<LuaEvent*> EventList;
     typedef std::unordered_map<int, LuaEvent*> EventMap;
 
-    ElunaEventProcessor(EventMgr* mgr, WorldObject* obj) : m_time(0), obj(obj), mgr(mgr) { }
+    ElunaEventProcessor(EventMgr* mgr, WorldObject* obj) : m_sequence(0), obj(obj), mgr(mgr) { }
     ~ElunaEventProcessor();
 
-    void Update(uint32 diff);
-    // removes all timed events on next tick or at tick end
+    // runs the events that are due at the current EventMgr time
+    void Update();
+    // removes all timed events now or at tick end
     void SetStates(LuaEventState state);
-    // set the event to be removed when executing
+    // removes the event now or at tick end
     void SetState(int eventId, LuaEventState state);
     void AddEvent(int funcRef, uint32 min, uint32 max, uint32 repeats);
 
@@ -103,17 +144,29 @@ private:
     void AddEvent(LuaEvent* luaEvent);
     void RemoveEvent(LuaEvent* luaEvent);
 
+    // eventList is a 4-ary min-heap on (dueTime, sequence), each event knows its own position in it
+    static bool RunsBefore(LuaEvent const* a, LuaEvent const* b);
+    void HeapPush(LuaEvent* luaEvent);
+    void HeapErase(LuaEvent* luaEvent);
+    void HeapSiftUp(uint32 index);
+    void HeapSiftDown(uint32 index);
+
     void QueueDeferredOp(DeferredOpType type, LuaEvent* event = nullptr, int eventId = 0, LuaEventState state = LUAEVENT_STATE_RUN);
     void ProcessDeferredOps();
     bool isUpdating = false;
+    // ops are queued to deferredOps and swapped to processingOps to run, both keep their capacity between ticks
     std::vector<DeferredOp> deferredOps;
+    std::vector<DeferredOp> processingOps;
 
     EventList eventList;
     EventMap eventMap;
-    uint64 m_time;
+    uint64 m_sequence;
 
     bool pendingDeletion = false;
 
+    uint32 slot = 0;                 // Index in the EventMgr processor slots
+    uint64 wakeTime = UINT64_MAX;    // Time of the EventMgr wakeup that will update this processor
+
     WorldObject* obj;
     EventMgr* mgr;
 };
@@ -140,6 +193,10 @@ public:
     void UpdateProcessors(uint32 diff);
     void SetAllEventStates(LuaEventState state);
     void SetEventState(int eventId, LuaEventState state);
+    // moves the global timed events of another manager to this one, keeping their remaining time and order
+    void MoveGlobalEvents(EventMgr& from);
+    // the state running the timed events, changed when a reloaded state takes over this manager
+    void SetEluna(Eluna* _E) { E = _E; }
 
     // Global (per state) processors
     ElunaEventProcessor* GetGlobalProcessor(GlobalEventSpace space);
@@ -149,18 +206,42 @@ public:
     ElunaEventProcessor* GetObjectProcessor(uint64 processorId);
     void FlagObjectProcessorForDeletion(uint64 processorId);
 
+    ElunaEventPoolStats const& GetEventPoolStats() const { return eventPool.GetStats(); }
+
 private:
-    typedef std::unordered_set<ElunaEventProcessor*> ProcessorSet;
     typedef std::unordered_map<uint64, std::unique_ptr<ElunaEventProcessor>> ObjectProcessorMap;
     typedef std::unordered_map<GlobalEventSpace, std::unique_ptr<ElunaEventProcessor>> GlobalProcessorsMap;
 
-    ProcessorSet processors; // tracks ALL processors (object + global)
+    struct ProcessorSlot
+    {
+        ElunaEventProcessor* processor = nullptr;
+        uint32 generation = 0; // bumped when the slot is freed, invalidates wakeups queued for the old processor
+    };
+
+    struct ProcessorWakeup
+    {
+        uint64 time;
+        uint32 slot;
+        uint32 generation;
+
+        bool operator>(ProcessorWakeup const& other) const { return time > other.time; }
+    };
+
+    ElunaEventPool eventPool; // declared first so it outlives the processors returning events to it
+    std::vector<ProcessorSlot> processorSlots; // tracks ALL processors (object + global)
+    std::vector<uint32> freeProcessorSlots;
+    std::vector<ProcessorWakeup> wakeups; // min-heap on time, holds at most one live wakeup per processor
+    std::vector<ProcessorWakeup> dueWakeups;
     GlobalProcessorsMap globalProcessors;
     ObjectProcessorMap objectProcessors;
     std::unordered_set<uint64> objectProcessorsPendingDelete;
+    uint64 m_time;
 
     Eluna* E;
 
+    void AddProcessor(ElunaEventProcessor* processor);
+    void RemoveProcessor(ElunaEventProcessor* processor);
+    void ScheduleProcessor(ElunaEventProcessor* processor, uint64 time);
     void CleanupObjectProcessors();
 
     friend class ElunaEventProcessor;
@@ -12,7 +12,14 @@
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <atomic>
+#include <algorithm>
 #include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <stdexcept>
 
 #if defined USING_BOOST
 #include <boost/filesystem.hpp>
@@ -38,6 +45,24 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+static int64 GetFileWriteTime(const fs::path& path)
+{
+#if defined USING_BOOST
+    return static_cast<int64>(fs::last_write_time(path));
+#else
+    return static_cast<int64>(fs::last_write_time(path).time_since_epoch().count());
+#endif
+}
+
+static void TouchFile(const fs::path& path)
+{
+#if defined USING_BOOST
+    fs::last_write_time(path, std::time(nullptr));
+#else
+    fs::last_write_time(path, fs::file_time_type::clock::now());
+#endif
+}
+
 #if defined ELUNA_TRINITY
 void ElunaUpdateListener::handleFileAction(efsw::WatchID /*watchid*/, std::string const& dir, std::string const& filename, efsw::Action /*action*/, std::string /*oldFilename*/)
 {
@@ -55,7 +80,7 @@ void ElunaUpdateListener::handleFileAction(efsw::WatchID /*watchid*/, std::strin
 }
 #endif
 
-ElunaLoader::ElunaLoader() : m_cacheState(SCRIPT_CACHE_NONE)
+ElunaLoader::ElunaLoader() : m_cacheState(SCRIPT_CACHE_NONE), m_cacheGeneration(0), m_bytecodeCacheHits(0), m_reusedScripts(0)
 {
 #if defined ELUNA_TRINITY
     lua_scriptWatcher = -1;
@@ -127,22 +152,45 @@ void ElunaLoader::LoadScripts()
 
     ELUNA_LOG_INFO("[Eluna]: Searching for scripts in `%s`", lua_folderpath.c_str());
 
-    // open a new temporary Lua state to compile bytecode in
-    lua_State* L = luaL_newstate();
-    luaL_openlibs(L);
-
     // clear all cache variables
     m_requirePath.clear();
     m_requirecPath.clear();
+    m_bytecodeCacheHits = 0;
+    m_reusedScripts = 0;
+
+    // make sure the bytecode cache folder exists, if it can not be created the cache is not used for this load
+    m_bytecodeCachePath = sElunaConfig->GetConfig(CONFIG_ELUNA_BYTECODE_CACHE_PATH);
+    if (!m_bytecodeCachePath.empty())
+    {
+        try
+        {
+            fs::create_directories(m_bytecodeCachePath);
+        }
+        catch (std::exception& e)
+        {
+            ELUNA_LOG_ERROR("[Eluna]: Bytecode cache disabled, could not create `%s`: %s", m_bytecodeCachePath.c_str(), e.what());
+            m_bytecodeCachePath.clear();
+        }
+    }
 
-    // read and compile all scripts
-    ReadFiles(L, lua_folderpath);
+    // find all scripts
+    uint32 phaseMSTime = ElunaUtil::GetCurrTime();
+    ReadFiles(lua_folderpath);
+    uint32 scanTime = ElunaUtil::GetTimeDiff(phaseMSTime);
 
-    // close temporary Lua state
-    lua_close(L);
+    // compile all scripts
+    phaseMSTime = ElunaUtil::GetCurrTime();
+    std::shared_ptr<const ScriptCache> previous = GetScriptCache();
+    size_t previousSize = previous ? previous->arena.size() : 0;
+    uint32 workerCount = CompileScripts(previous.get());
+    previous.reset();
+    TrimBytecodeCache();
+    uint32 compileTime = ElunaUtil::GetTimeDiff(phaseMSTime);
 
     // combine lists of Lua scripts and extensions
-    CombineLists();
+    phaseMSTime = ElunaUtil::GetCurrTime();
+    std::shared_ptr<ScriptCache> cache = CombineLists();
+    uint32 combineTime = ElunaUtil::GetTimeDiff(phaseMSTime);
 
     // append our custom require paths and cpaths if the config variables are not empty
     if (!lua_path_extra.empty())
@@ -158,20 +206,58 @@ void ElunaLoader::LoadScripts()
     if (!m_requirecPath.empty())
         m_requirecPath.erase(m_requirecPath.end() - 1);
 
-    ELUNA_LOG_INFO("[Eluna]: Loaded and precompiled %u scripts in %u ms", uint32(m_scriptCache.size()), ElunaUtil::GetTimeDiff(oldMSTime));
+    cache->requirePath = std::move(m_requirePath);
+    cache->requirecPath = std::move(m_requirecPath);
+
+    ELUNA_LOG_INFO("[Eluna]: Loaded and precompiled %u scripts in %u ms (scan: %u ms, compile: %u ms on %u threads, %u unchanged, %u from bytecode cache, combine: %u ms)",
+        uint32(cache->scripts.size()), ElunaUtil::GetTimeDiff(oldMSTime), scanTime, compileTime, workerCount, m_reusedScripts, uint32(m_bytecodeCacheHits), combineTime);
 
-    // set the cache state to ready
+    // every state loads the whole bytecode, so its size is reported against the previous load
+    uint32 strippedCount = uint32(std::count_if(cache->scripts.begin(), cache->scripts.end(), [](const LuaScript& script) { return script.stripped; }));
+    ELUNA_LOG_INFO("[Eluna]: Script cache holds %u KB of bytecode, %u scripts stripped of debug info (previous cache: %u KB)",
+        uint32(cache->arena.size() / 1024), strippedCount, uint32(previousSize / 1024));
+
+    if (uint32 reportSize = sElunaConfig->GetConfig(CONFIG_ELUNA_LOAD_REPORT_SIZE))
+    {
+        std::vector<const LuaScript*> slowest;
+        slowest.reserve(cache->scripts.size());
+        for (const LuaScript& script : cache->scripts)
+            slowest.push_back(&script);
+
+        std::sort(slowest.begin(), slowest.end(), [](const LuaScript* a, const LuaScript* b) { return a->compileTime > b->compileTime; });
+        if (slowest.size() > reportSize)
+            slowest.resize(reportSize);
+
+        ELUNA_LOG_INFO("[Eluna]: Slowest %u scripts to compile:", uint32(slowest.size()));
+        for (const LuaScript* script : slowest)
+            ELUNA_LOG_INFO("[Eluna]:   `%s`: %.2f ms, %u bytes of bytecode", script->filepath.c_str(), script->compileTime / 1000.0, uint32(script->bytecodeSize));
+    }
+
+    // publish the new cache, states opened from now on use it while states already open keep theirs
+    {
+        std::lock_guard<std::mutex> lock(m_scriptCacheLock);
+        m_scriptCache = std::move(cache);
+    }
+
+    // publish the new cache generation and set the cache state to ready
+    ++m_cacheGeneration;
     m_cacheState = SCRIPT_CACHE_READY;
 }
 
+std::shared_ptr<const ScriptCache> ElunaLoader::GetScriptCache() const
+{
+    std::lock_guard<std::mutex> lock(m_scriptCacheLock);
+    return m_scriptCache;
+}
+
 int ElunaLoader::LoadBytecodeChunk(lua_State* /*L*/, uint8* bytes, size_t len, BytecodeBuffer* buffer)
 {
     buffer->insert(buffer->end(), bytes, bytes + len);
     return 0;
 }
 
-// Finds lua script files from given path (including subdirectories) and pushes them to scripts
-void ElunaLoader::ReadFiles(lua_State* L, std::string path)
+// Finds lua script files from given path (including subdirectories) and pushes them to the scripts to compile
+void ElunaLoader::ReadFiles(std::string path)
 {
     std::string lua_folderpath = sElunaConfig->GetConfig(CONFIG_ELUNA_SCRIPT_PATH);
 
@@ -208,7 +294,7 @@ void ElunaLoader::ReadFiles(lua_State* L, std::string path)
             // load subfolder
             if (fs::is_directory(dir_iter->status()))
             {
-                ReadFiles(L, fullpath);
+                ReadFiles(fullpath);
                 continue;
             }
 
@@ -231,7 +317,8 @@ void ElunaLoader::ReadFiles(lua_State* L, std::string path)
                 // was file, try add
                 std::string filename = dir_iter->path().filename().generic_string();
                 size_t filesize = fs::file_size(dir_iter->path());
-                ProcessScript(L, filename, filesize, fullpath, mapId);
+                int64 filetime = GetFileWriteTime(dir_iter->path());
+                ProcessScript(filename, filesize, filetime, fullpath, mapId);
             }
         }
     }
@@ -258,7 +345,33 @@ bool ElunaLoader::CompileScript(lua_State* L, LuaScript& script)
     ELUNA_LOG_DEBUG("[Eluna]: CompileScript loaded Lua script `%s`", script.filename.c_str());
 
     // Everything's OK so far, the script has been loaded, now we need to start dumping it to bytecode.
-    err = lua_dump(L, (lua_Writer)LoadBytecodeChunk, &script.bytecode);
+#if LUA_VERSION_NUM > 502
+    // the parentheses skip the compatibility macro, which always keeps the debug info
+    err = (lua_dump)(L, (lua_Writer)LoadBytecodeChunk, &script.bytecode, script.stripped ? 1 : 0);
+#else
+#if defined LUAJIT_VERSION
+    if (script.stripped)
+    {
+        // LuaJIT only strips the debug info through string.dump
+        lua_getglobal(L, "string");
+        lua_getfield(L, -1, "dump");
+        lua_remove(L, -2);
+        lua_pushvalue(L, -2);
+        lua_pushboolean(L, 1);
+        // Stack: function, string.dump, function, true
+        err = lua_pcall(L, 2, 1, 0);
+        if (!err)
+        {
+            size_t len = 0;
+            const char* bytes = lua_tolstring(L, -1, &len);
+            script.bytecode.assign(bytes, bytes + len);
+            lua_pop(L, 1);
+        }
+    }
+    else
+#endif
+        err = lua_dump(L, (lua_Writer)LoadBytecodeChunk, &script.bytecode);
+#endif
     if (err || script.bytecode.empty())
     {
         ELUNA_LOG_ERROR("[Eluna]: CompileScript failed to dump the Lua script `%s` to bytecode.", script.filename.c_str());
@@ -272,7 +385,7 @@ bool ElunaLoader::CompileScript(lua_State* L, LuaScript& script)
     return true;
 }
 
-void ElunaLoader::ProcessScript(lua_State* L, std::string filename, const size_t& filesize, const std::string& fullpath, int32 mapId)
+void ElunaLoader::ProcessScript(std::string filename, const size_t& filesize, int64 filetime, const std::string& fullpath, int32 mapId)
 {
     ELUNA_LOG_DEBUG("[Eluna]: ProcessScript checking file `%s`", fullpath.c_str());
 
@@ -286,7 +399,6 @@ void ElunaLoader::ProcessScript(lua_State* L, std::string filename, const size_t
     // check extension and add path to scripts to load
     if (ext != ".lua" && ext != ".ext" && ext != ".moon")
         return;
-    bool extension = ext == ".ext";
 
     LuaScript script;
     script.fileext = ext;
@@ -294,18 +406,375 @@ void ElunaLoader::ProcessScript(lua_State* L, std::string filename, const size_t
     script.filepath = fullpath;
     script.modulepath = fullpath.substr(0, fullpath.length() - filename.length() - ext.length());
     script.bytecode.reserve(filesize);
+    script.bytecodeOffset = 0;
+    script.bytecodeSize = 0;
     script.mapId = mapId;
+    script.filesize = filesize;
+    script.filetime = filetime;
+    script.contenthash = 0;
+#if LUA_VERSION_NUM > 502 || defined LUAJIT_VERSION
+    script.stripped = sElunaConfig->ShouldStripBytecode(filename);
+#else
+    // Lua 5.1 and 5.2 can not dump bytecode without debug info
+    script.stripped = false;
+#endif
+    script.compileTime = 0;
+
+    m_pendingScripts.push_back(std::move(script));
 
-    // if compilation fails, we don't add the script 
+    ELUNA_LOG_DEBUG("[Eluna]: ProcessScript processed `%s` successfully", fullpath.c_str());
+}
+
+// FNV-1a, only used to detect changed files and to name cache entries
+static uint64 HashBytes(const char* data, size_t len, uint64 hash = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= static_cast<uint8>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool HashFile(const std::string& filepath, uint64& hash)
+{
+    try
+    {
+        std::ifstream source(filepath, std::ios::binary);
+        if (!source)
+            return false;
+
+        std::string content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+        hash = HashBytes(content.data(), content.size());
+        return true;
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+}
+
+// Compiles the found scripts on a pool of threads and returns the amount of threads used
+uint32 ElunaLoader::CompileScripts(const ScriptCache* previousCache)
+{
+    size_t scriptCount = m_pendingScripts.size();
+
+    // not a vector<bool> since the workers write their results concurrently
+    std::vector<uint8> compiled(scriptCount, 0);
+
+    // on an incremental reload files with the same size, modification time and content as in the previous cache are not compiled again,
+    // the content is compared as well since modification times can have a resolution of a second or more
+    bool incremental = sElunaConfig->GetConfig(CONFIG_ELUNA_INCREMENTAL_RELOAD);
+    std::vector<size_t> toCompile;
+    toCompile.reserve(scriptCount);
+    if (incremental && previousCache)
+    {
+        std::unordered_map<std::string, const LuaScript*> previous;
+        previous.reserve(previousCache->scripts.size());
+        for (const LuaScript& script : previousCache->scripts)
+            previous.emplace(script.filepath, &script);
+
+        for (size_t i = 0; i < scriptCount; ++i)
+        {
+            LuaScript& script = m_pendingScripts[i];
+            auto itr = previous.find(script.filepath);
+            if (itr != previous.end() && itr->second->filesize == script.filesize && itr->second->filetime == script.filetime && itr->second->stripped == script.stripped &&
+                itr->second->contenthash && HashFile(script.filepath, script.contenthash) && itr->second->contenthash == script.contenthash)
+            {
+                const char* bytecode = previousCache->GetBytecode(*itr->second);
+                script.bytecode.assign(bytecode, bytecode + itr->second->bytecodeSize);
+                compiled[i] = 1;
+                ++m_reusedScripts;
+                continue;
+            }
+
+            toCompile.push_back(i);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < scriptCount; ++i)
+            toCompile.push_back(i);
+    }
+
+    uint32 workerCount = sElunaConfig->GetConfig(CONFIG_ELUNA_COMPILE_THREADS);
+    if (!workerCount)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    workerCount = static_cast<uint32>(std::max<size_t>(1, std::min<size_t>(workerCount, toCompile.size())));
+
+    std::atomic<size_t> nextScript(0);
+
+    auto worker = [&]()
+    {
+        if (toCompile.empty())
+            return;
+
+        // each worker compiles in its own temporary Lua state
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+
+        for (size_t next = nextScript++; next < toCompile.size(); next = nextScript++)
+        {
+            LuaScript& script = m_pendingScripts[toCompile[next]];
+            auto start = std::chrono::steady_clock::now();
+            // hashed before compiling, if the file changes in between the next reload sees a different hash and compiles it again
+            if (incremental && !HashFile(script.filepath, script.contenthash))
+                script.contenthash = 0;
+            compiled[toCompile[next]] = LoadOrCompileScript(L, script);
+            script.compileTime = uint32(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        lua_close(L);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount - 1);
+    for (uint32 i = 1; i < workerCount; ++i)
+        workers.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : workers)
+        thread.join();
+
+    // hand the results over in the order the files were found, if compilation failed we don't add the script
+    for (size_t i = 0; i < scriptCount; ++i)
+    {
+        if (!compiled[i])
+            continue;
+
+        LuaScript& script = m_pendingScripts[i];
+        if (script.fileext == ".ext")
+            m_extensions.push_back(std::move(script));
+        else
+            m_scripts.push_back(std::move(script));
+    }
+
+    m_pendingScripts.clear();
+    return workerCount;
+}
+
+// Bytecode cache entries start with this header, any mismatch makes the entry stale
+static const char BytecodeCacheMagic[4] = { 'E', 'L', 'B', 'C' };
+static const uint32 BytecodeCacheFormat = 2;
+#if defined LUAJIT_VERSION
+static const std::string BytecodeCacheLuaVersion = LUAJIT_VERSION;
+#else
+static const std::string BytecodeCacheLuaVersion = LUA_RELEASE;
+#endif
+
+struct BytecodeCacheKey
+{
+    std::string filepath;
+    uint64 filesize = 0;
+    int64 filetime = 0;
+    uint64 contentHash = 0;
+    uint8 stripped = 0;
+};
+
+static bool ReadBytecodeCacheKey(const LuaScript& script, BytecodeCacheKey& key)
+{
+    try
+    {
+        std::ifstream source(script.filepath, std::ios::binary);
+        if (!source)
+            return false;
+
+        std::string content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+
+        key.filepath = script.filepath;
+        key.filesize = content.size();
+        key.filetime = GetFileWriteTime(script.filepath);
+        key.contentHash = HashBytes(content.data(), content.size());
+        key.stripped = script.stripped ? 1 : 0;
+        return true;
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+}
+
+template<typename T>
+static void WriteValue(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool ReadValue(std::istream& in, T& value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static void WriteString(std::ostream& out, const std::string& value)
+{
+    WriteValue(out, uint32(value.size()));
+    out.write(value.data(), value.size());
+}
+
+static bool ReadString(std::istream& in, std::string& value)
+{
+    uint32 len = 0;
+    if (!ReadValue(in, len) || len > 0xFFFF)
+        return false;
+
+    value.resize(len);
+    return bool(in.read(&value[0], len));
+}
+
+static void WriteBytecodeCacheHeader(std::ostream& out, const BytecodeCacheKey& key)
+{
+    out.write(BytecodeCacheMagic, sizeof(BytecodeCacheMagic));
+    WriteValue(out, BytecodeCacheFormat);
+    WriteString(out, BytecodeCacheLuaVersion);
+    WriteString(out, key.filepath);
+    WriteValue(out, key.filesize);
+    WriteValue(out, key.filetime);
+    WriteValue(out, key.contentHash);
+    WriteValue(out, key.stripped);
+}
+
+static bool CheckBytecodeCacheHeader(std::istream& in, const BytecodeCacheKey& key)
+{
+    char magic[sizeof(BytecodeCacheMagic)];
+    uint32 format = 0;
+    std::string luaVersion, filepath;
+    BytecodeCacheKey stored;
+
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), BytecodeCacheMagic))
+        return false;
+    if (!ReadValue(in, format) || format != BytecodeCacheFormat)
+        return false;
+    if (!ReadString(in, luaVersion) || luaVersion != BytecodeCacheLuaVersion)
+        return false;
+    if (!ReadString(in, filepath) || filepath != key.filepath)
+        return false;
+    if (!ReadValue(in, stored.filesize) || !ReadValue(in, stored.filetime) || !ReadValue(in, stored.contentHash) || !ReadValue(in, stored.stripped))
+        return false;
+
+    return stored.filesize == key.filesize && stored.filetime == key.filetime && stored.contentHash == key.contentHash && stored.stripped == key.stripped;
+}
+
+std::string ElunaLoader::GetBytecodeCacheFile(const LuaScript& script) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.elc", static_cast<unsigned long long>(HashBytes(script.filepath.data(), script.filepath.size())));
+    return m_bytecodeCachePath + "/" + name;
+}
+
+// Called by the compile workers, uses the cached bytecode if the source is unchanged and caches newly compiled bytecode
+bool ElunaLoader::LoadOrCompileScript(lua_State* L, LuaScript& script)
+{
+    if (m_bytecodeCachePath.empty())
+        return CompileScript(L, script);
+
+    BytecodeCacheKey key;
+    if (!ReadBytecodeCacheKey(script, key))
+        return CompileScript(L, script);
+
+    std::string cacheFile = GetBytecodeCacheFile(script);
+    try
+    {
+        std::ifstream in(cacheFile, std::ios::binary);
+        uint64 size = 0;
+        if (in && CheckBytecodeCacheHeader(in, key) && ReadValue(in, size) && size && size <= key.filesize * 16 + 4096) // bound a corrupt size field
+        {
+            script.bytecode.resize(size);
+            if (in.read(reinterpret_cast<char*>(script.bytecode.data()), size) && in.peek() == EOF)
+            {
+                // the modification time of an entry is its last use, the least recently used entries are evicted first
+                in.close();
+                TouchFile(cacheFile);
+
+                ++m_bytecodeCacheHits;
+                ELUNA_LOG_DEBUG("[Eluna]: Loaded `%s` from the bytecode cache", script.filepath.c_str());
+                return true;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        ELUNA_LOG_DEBUG("[Eluna]: Could not read bytecode cache entry `%s`: %s", cacheFile.c_str(), e.what());
+    }
+
+    script.bytecode.clear();
     if (!CompileScript(L, script))
+        return false;
+
+    // write to a temporary file first so a partial entry is never read
+    std::string tempFile = cacheFile + ".tmp";
+    try
+    {
+        {
+            std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+            WriteBytecodeCacheHeader(out, key);
+            WriteValue(out, uint64(script.bytecode.size()));
+            out.write(reinterpret_cast<const char*>(script.bytecode.data()), script.bytecode.size());
+            if (!out)
+                throw std::runtime_error("write failed");
+        }
+        fs::rename(tempFile, cacheFile);
+    }
+    catch (std::exception& e)
+    {
+        ELUNA_LOG_ERROR("[Eluna]: Could not write bytecode cache entry `%s`: %s", cacheFile.c_str(), e.what());
+    }
+
+    return true;
+}
+
+// Evicts the least recently used bytecode cache entries until the cache fits in Eluna.BytecodeCacheSize megabytes
+void ElunaLoader::TrimBytecodeCache()
+{
+    uint64 maxSize = uint64(sElunaConfig->GetConfig(CONFIG_ELUNA_BYTECODE_CACHE_SIZE)) * 1024 * 1024;
+    if (m_bytecodeCachePath.empty() || !maxSize)
         return;
 
-    if (extension)
-        m_extensions.push_back(script);
-    else
-        m_scripts.push_back(script);
+    struct CacheEntry
+    {
+        int64 lastUse;
+        uint64 size;
+        fs::path path;
+    };
 
-    ELUNA_LOG_DEBUG("[Eluna]: ProcessScript processed `%s` successfully", fullpath.c_str());
+    try
+    {
+        std::vector<CacheEntry> entries;
+        uint64 totalSize = 0;
+
+        for (fs::directory_iterator dir_iter(m_bytecodeCachePath), end_iter; dir_iter != end_iter; ++dir_iter)
+        {
+            if (!fs::is_regular_file(dir_iter->status()) || dir_iter->path().extension().string() != ".elc")
+                continue;
+
+            uint64 size = fs::file_size(dir_iter->path());
+            entries.push_back({ GetFileWriteTime(dir_iter->path()), size, dir_iter->path() });
+            totalSize += size;
+        }
+
+        if (totalSize <= maxSize)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.lastUse < b.lastUse; });
+
+        uint32 evicted = 0;
+        for (const CacheEntry& entry : entries)
+        {
+            if (totalSize <= maxSize)
+                break;
+
+            fs::remove(entry.path);
+            totalSize -= entry.size;
+            ++evicted;
+        }
+
+        ELUNA_LOG_DEBUG("[Eluna]: Evicted %u entries from the bytecode cache", evicted);
+    }
+    catch (std::exception& e)
+    {
+        ELUNA_LOG_ERROR("[Eluna]: Could not trim the bytecode cache `%s`: %s", m_bytecodeCachePath.c_str(), e.what());
+    }
 }
 
 #if defined ELUNA_TRINITY
@@ -332,19 +801,50 @@ static bool ScriptPathComparator(const LuaScript& first, const LuaScript& second
     return first.filepath < second.filepath;
 }
 
-void ElunaLoader::CombineLists()
+std::shared_ptr<ScriptCache> ElunaLoader::CombineLists()
 {
     m_extensions.sort(ScriptPathComparator);
     m_scripts.sort(ScriptPathComparator);
 
-    m_scriptCache.clear();
-    m_scriptCache.reserve(m_extensions.size() + m_scripts.size());
+    auto cache = std::make_shared<ScriptCache>();
+    cache->scripts.reserve(m_extensions.size() + m_scripts.size());
 
-    std::move(m_extensions.begin(), m_extensions.end(), std::back_inserter(m_scriptCache));
-    std::move(m_scripts.begin(), m_scripts.end(), std::back_inserter(m_scriptCache));
+    std::move(m_extensions.begin(), m_extensions.end(), std::back_inserter(cache->scripts));
+    std::move(m_scripts.begin(), m_scripts.end(), std::back_inserter(cache->scripts));
 
     m_extensions.clear();
     m_scripts.clear();
+
+    // move all bytecode to one arena and index the scripts by name, require loads the first script found with a name
+    size_t arenaSize = 0;
+    for (const LuaScript& script : cache->scripts)
+        arenaSize += script.bytecode.size();
+    cache->arena.reserve(arenaSize);
+    cache->modules.reserve(cache->scripts.size());
+
+    for (size_t i = 0; i < cache->scripts.size(); ++i)
+    {
+        LuaScript& script = cache->scripts[i];
+        script.bytecodeOffset = cache->arena.size();
+        script.bytecodeSize = script.bytecode.size();
+        cache->arena.insert(cache->arena.end(), script.bytecode.begin(), script.bytecode.end());
+        BytecodeBuffer().swap(script.bytecode);
+
+        cache->modules.emplace(script.filename, i);
+
+        if (script.mapId == -1)
+            cache->globalScripts.push_back(i);
+        else
+            cache->mapScripts[script.mapId];
+    }
+
+    // every map with its own scripts gets the merged load order of global and map specific scripts
+    for (auto& [mapId, indexes] : cache->mapScripts)
+        for (size_t i = 0; i < cache->scripts.size(); ++i)
+            if (cache->scripts[i].mapId == -1 || cache->scripts[i].mapId == mapId)
+                indexes.push_back(i);
+
+    return cache;
 }
 
 void ElunaLoader::ReloadElunaForMap(int mapId)
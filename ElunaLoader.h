@@ -35,6 +35,7 @@ enum ElunaScriptCacheState
 };
 
 struct LuaScript;
+struct ScriptCache;
 
 class ElunaLoader
 {
@@ -54,9 +55,10 @@ public:
     void ReloadElunaForMap(int mapId);
 
     uint8 GetCacheState() const { return m_cacheState; }
-    const std::vector<LuaScript>& GetLuaScripts() const { return m_scriptCache; }
-    const std::string& GetRequirePath() const { return m_requirePath; }
-    const std::string& GetRequireCPath() const { return m_requirecPath; }
+    // increased every time a new script cache is ready
+    uint32 GetCacheGeneration() const { return m_cacheGeneration; }
+    // the latest published script cache, nullptr until the first load finishes
+    std::shared_ptr<const ScriptCache> GetScriptCache() const;
 
 #if defined ELUNA_TRINITY
     // efsw file watcher
@@ -67,16 +69,28 @@ public:
 
 private:
     void ReloadScriptCache();
-    void ReadFiles(lua_State* L, std::string path);
-    void CombineLists();
-    void ProcessScript(lua_State* L, std::string filename, const size_t& filesize, const std::string& fullpath, int32 mapId);
+    void ReadFiles(std::string path);
+    uint32 CompileScripts(const ScriptCache* previous);
+    std::shared_ptr<ScriptCache> CombineLists();
+    void ProcessScript(std::string filename, const size_t& filesize, int64 filetime, const std::string& fullpath, int32 mapId);
     bool CompileScript(lua_State* L, LuaScript& script);
     static int LoadBytecodeChunk(lua_State* L, uint8* bytes, size_t len, BytecodeBuffer* buffer);
 
+    // persistent bytecode cache, only used when Eluna.BytecodeCachePath is set
+    bool LoadOrCompileScript(lua_State* L, LuaScript& script);
+    std::string GetBytecodeCacheFile(const LuaScript& script) const;
+    void TrimBytecodeCache();
+
     std::atomic<uint8> m_cacheState;
-    std::vector<LuaScript> m_scriptCache;
+    std::atomic<uint32> m_cacheGeneration;
+    std::shared_ptr<const ScriptCache> m_scriptCache;
+    mutable std::mutex m_scriptCacheLock;
     std::string m_requirePath;
     std::string m_requirecPath;
+    std::vector<LuaScript> m_pendingScripts;
+    std::string m_bytecodeCachePath;
+    std::atomic<uint32> m_bytecodeCacheHits;
+    uint32 m_reusedScripts;
     std::list<LuaScript> m_scripts;
     std::list<LuaScript> m_extensions;
     std::thread m_reloadThread;
@@ -7,8 +7,12 @@
 #include "ElunaMgr.h"
 #include "LuaEngine.h"
 
+#include <mutex>
+
 ElunaMgr::ElunaMgr()
 {
+    for (std::atomic<uint32>& generation : _generations)
+        generation.store(1, std::memory_order_relaxed);
 }
 
 ElunaMgr* ElunaMgr::instance()
@@ -23,16 +27,27 @@ ElunaMgr::~ElunaMgr()
 
 void ElunaMgr::Create(Map* map, ElunaInfo const& info)
 {
-    // If already exists, do nothing
-    bool keyExists = info.IsValid() && (_elunaMap.find(info.key) != _elunaMap.end());
-    if (keyExists)
-        return;
+    {
+        std::shared_lock<std::shared_mutex> lock(_lock);
+
+        // If already exists, do nothing
+        bool keyExists = info.IsValid() && (_elunaMap.find(info.key) != _elunaMap.end());
+        if (keyExists)
+            return;
+    }
 
-    _elunaMap.emplace(info.key, std::make_unique<Eluna>(map));
+    // the state runs scripts when created, so it is created without holding the lock
+    auto E = std::make_unique<Eluna>(map);
+
+    std::unique_lock<std::shared_mutex> lock(_lock);
+    _elunaMap.emplace(info.key, std::move(E));
+    BumpGeneration(info.key);
 }
 
 Eluna* ElunaMgr::Get(ElunaInfoKey key) const
 {
+    std::shared_lock<std::shared_mutex> lock(_lock);
+
     auto it = _elunaMap.find(key);
     if (it != _elunaMap.end())
         return it->second.get();
@@ -42,12 +57,33 @@ Eluna* ElunaMgr::Get(ElunaInfoKey key) const
 
 Eluna* ElunaMgr::Get(ElunaInfo const& info) const
 {
-    return Get(info.key);
+    std::shared_lock<std::shared_mutex> lock(_lock);
+
+    // the generation does not change while the lock is shared, so threads caching at the same time store the same values
+    auto it = _elunaMap.find(info.key);
+    Eluna* E = it != _elunaMap.end() ? it->second.get() : nullptr;
+    info.cachedEluna.store(E, std::memory_order_relaxed);
+    info.cachedGeneration.store(GetGenerationSlot(info.key).load(std::memory_order_relaxed), std::memory_order_release);
+    return E;
 }
 
 void ElunaMgr::Destroy(ElunaInfoKey key)
 {
-    _elunaMap.erase(key);
+    std::unique_ptr<Eluna> E;
+    {
+        std::unique_lock<std::shared_mutex> lock(_lock);
+
+        auto it = _elunaMap.find(key);
+        if (it != _elunaMap.end())
+        {
+            E = std::move(it->second);
+            _elunaMap.erase(it);
+        }
+        BumpGeneration(key);
+    }
+
+    // closing the state runs scripts, so it is destroyed without holding the lock
+    E.reset();
 }
 
 void ElunaMgr::Destroy(ElunaInfo const& info)
@@ -55,6 +91,31 @@ void ElunaMgr::Destroy(ElunaInfo const& info)
     Destroy(info.key);
 }
 
+bool ElunaMgr::Replace(Eluna* current, std::unique_ptr<Eluna>& state)
+{
+    std::unique_lock<std::shared_mutex> lock(_lock);
+
+    // states do not know their key, reloads are rare enough to look for the state itself
+    for (auto& [key, E] : _elunaMap)
+    {
+        if (E.get() != current)
+            continue;
+
+        E.swap(state);
+        BumpGeneration(key);
+        return true;
+    }
+
+    return false;
+}
+
+ElunaInfo& ElunaInfo::operator=(ElunaInfo const& other)
+{
+    key = other.key;
+    cachedGeneration.store(0, std::memory_order_release);
+    return *this;
+}
+
 ElunaInfo::~ElunaInfo()
 {
 }
@@ -81,8 +142,12 @@ uint32 ElunaInfo::GetInstanceId() const
 
 Eluna* ElunaInfo::GetEluna() const
 {
-    if (IsValid() && sElunaMgr)
-        return sElunaMgr->Get(key);
+    if (!IsValid() || !sElunaMgr)
+        return nullptr;
 
-    return nullptr;
+    // the cached state is stored before its generation, so a matching generation means the state is the one of that generation
+    if (cachedGeneration.load(std::memory_order_acquire) == sElunaMgr->GetGeneration(key))
+        return cachedEluna.load(std::memory_order_relaxed);
+
+    return sElunaMgr->Get(*this);
 }
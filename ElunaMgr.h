@@ -9,8 +9,10 @@
 
 #include "Common.h"
 
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <shared_mutex>
 #include <unordered_map>
 
 class Eluna;
@@ -64,9 +66,13 @@ namespace std
 
 struct ElunaInfo
 {
+    friend class ElunaMgr;
+
 public:
     ElunaInfo() : key() {}
     ElunaInfo(ElunaInfoKey key) : key(key) {}
+    ElunaInfo(ElunaInfo const& other) : key(other.key) {}
+    ElunaInfo& operator=(ElunaInfo const& other);
     ~ElunaInfo();
 
 public:
@@ -76,11 +82,16 @@ public:
     uint32 GetMapId() const;
     uint32 GetInstanceId() const;
 
-    // Getter to fetch Eluna object
+    // Getter to fetch Eluna object, a pointer load while the ElunaMgr states are unchanged
     Eluna* GetEluna() const;
 
 public:
     ElunaInfoKey key;
+
+private:
+    // State found for the key in the ElunaMgr generation `cachedGeneration`, 0 if nothing is cached
+    mutable std::atomic<Eluna*> cachedEluna { nullptr };
+    mutable std::atomic<uint32> cachedGeneration { 0 };
 };
 
 class ElunaMgr
@@ -102,8 +113,40 @@ public:
     void Destroy(ElunaInfoKey key);
     void Destroy(ElunaInfo const& info);
 
+    // Puts the reloaded state `state` in place of `current` and leaves `current` in `state`.
+    // Returns false and leaves `state` unchanged if `current` is not managed here
+    bool Replace(Eluna* current, std::unique_ptr<Eluna>& state);
+
+    // Calls `f` with every created state, states are not destroyed meanwhile but may be running on their map threads
+    template<typename F>
+    void ForEach(F&& f) const
+    {
+        std::shared_lock<std::shared_mutex> lock(_lock);
+        for (auto const& [key, E] : _elunaMap)
+            f(E.get());
+    }
+
+    // Changes every time a state with a key that shares the generation with `key` is added, removed or replaced,
+    // states cached by ElunaInfo are valid until then
+    uint32 GetGeneration(ElunaInfoKey key) const { return GetGenerationSlot(key).load(std::memory_order_acquire); }
+
 private:
+    // Keys are spread over a few generations so that creating or destroying one map does not
+    // invalidate the states cached for all the others
+    static constexpr size_t GENERATION_COUNT = 64;
+    std::atomic<uint32>& GetGenerationSlot(ElunaInfoKey key) const { return _generations[(key.GetMapId() * 31 + key.GetInstanceId()) % GENERATION_COUNT]; }
+    // Called with the lock held uniquely whenever _elunaMap changes for `key`
+    void BumpGeneration(ElunaInfoKey key)
+    {
+        std::atomic<uint32>& generation = GetGenerationSlot(key);
+        if (generation.fetch_add(1, std::memory_order_release) + 1 == 0)
+            generation.store(1, std::memory_order_release);
+    }
+
+    mutable std::shared_mutex _lock;
     std::unordered_map<ElunaInfoKey, std::unique_ptr<Eluna>> _elunaMap;
+    // Start at 1 so that an ElunaInfo that has not cached anything yet never matches
+    mutable std::atomic<uint32> _generations[GENERATION_COUNT];
 };
 
 #define sElunaMgr ElunaMgr::instance()
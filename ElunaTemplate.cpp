@@ -10,6 +10,14 @@
 #include "ElunaTemplate.h"
 #include "ElunaUtility.h"
 
+#include <atomic>
+
+uint32 ElunaNextTemplateTypeIndex()
+{
+    static std::atomic<uint32> nextIndex(0);
+    return nextIndex++;
+}
+
 #if defined TRACKABLE_PTR_NAMESPACE
 ElunaConstrainedObjectRef<Aura> GetWeakPtrFor(Aura const* obj)
 {
@@ -29,10 +29,17 @@ extern "C"
 #include "UniqueTrackablePtr.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
 class ElunaObject
 {
 public:
-    ElunaObject(Eluna* E, char const* tname) : E(E), type_name(tname)
+    ElunaObject(Eluna* E, char const* tname, uint32 typeIndex, uint64 ancestry) : E(E), type_name(tname), type_index(typeIndex), type_ancestry(ancestry)
     {
     }
 
@@ -42,8 +49,14 @@ public:
 
     // Get wrapped object pointer
     virtual void* GetObjIfValid() const = 0;
+    // Get wrapped object pointer as Object, nullptr if the wrapped type is not derived from Object
+    virtual Object* GetBaseObjIfValid() const { return nullptr; }
     // Returns pointer to the wrapped object's type name
     const char* GetTypeName() const { return type_name; }
+    // Returns the wrapped object's type index, see ElunaTemplate<T>::GetTypeIndex
+    uint32 GetTypeIndex() const { return type_index; }
+    // Returns the type bits of the wrapped object's type and its registered base types, see ElunaTemplate<T>::GetTypeBit
+    uint64 GetTypeAncestry() const { return type_ancestry; }
 #if !defined TRACKABLE_PTR_NAMESPACE
     // Invalidates the pointer if it should be invalidated
     virtual void Invalidate() = 0;
@@ -52,6 +65,8 @@ public:
 protected:
     Eluna* E;
     const char* type_name;
+    uint32 type_index;
+    uint64 type_ancestry;
 };
 
 #if defined TRACKABLE_PTR_NAMESPACE
@@ -90,7 +105,7 @@ class ElunaObjectImpl : public ElunaObject
 {
 public:
 #if defined TRACKABLE_PTR_NAMESPACE
-    ElunaObjectImpl(Eluna* E, T const* obj, char const* tname) : ElunaObject(E, tname), _obj(GetWeakPtrFor(obj))
+    ElunaObjectImpl(Eluna* E, T const* obj, char const* tname, uint32 typeIndex, uint64 ancestry) : ElunaObject(E, tname, typeIndex, ancestry), _obj(GetWeakPtrFor(obj))
     {
     }
 
@@ -103,7 +118,7 @@ public:
         return nullptr;
     }
 #else
-    ElunaObjectImpl(Eluna* E, T* obj, char const* tname) : ElunaObject(E, tname), _obj(obj), callstackid(E->GetCallstackId())
+    ElunaObjectImpl(Eluna* E, T* obj, char const* tname, uint32 typeIndex, uint64 ancestry) : ElunaObject(E, tname, typeIndex, ancestry), _obj(obj), callstackid(E->GetCallstackId())
     {
     }
 
@@ -118,6 +133,14 @@ public:
     void Invalidate() override { callstackid = 1; }
 #endif
 
+    Object* GetBaseObjIfValid() const override
+    {
+        if constexpr (std::is_base_of_v<Object, T>)
+            return static_cast<T*>(GetObjIfValid());
+        else
+            return nullptr;
+    }
+
 private:
 #if defined TRACKABLE_PTR_NAMESPACE
     ElunaConstrainedObjectRef<T> _obj;
@@ -131,7 +154,7 @@ template <typename T>
 class ElunaObjectValueImpl : public ElunaObject
 {
 public:
-    ElunaObjectValueImpl(Eluna* E, T const* obj, char const* tname) : ElunaObject(E, tname), _obj(*obj /*always a copy, what gets passed here might be pointing to something not owned by us*/)
+    ElunaObjectValueImpl(Eluna* E, T const* obj, char const* tname, uint32 typeIndex, uint64 ancestry) : ElunaObject(E, tname, typeIndex, ancestry), _obj(*obj /*always a copy, what gets passed here might be pointing to something not owned by us*/)
     {
     }
 
@@ -160,6 +183,15 @@ MAKE_ELUNA_OBJECT_VALUE_IMPL(WorldPacket);
 MAKE_ELUNA_OBJECT_VALUE_IMPL(ElunaQuery);
 MAKE_ELUNA_OBJECT_VALUE_IMPL(ElunaSpellInfo);
 
+// Tag for class methods that are called through their own trampoline instead of the generic thunk.
+// Meant for small hot methods, which must push exactly as many values as they return.
+// Usage in a method table: { "GetX", ElunaDirect<&LuaWorldObject::GetX>() }
+template<auto Method>
+struct ElunaDirect { };
+
+template<typename T, int(*Method)(Eluna*, T*)>
+int ElunaDirectMethod(lua_State* L);
+
 template<typename T = void>
 struct ElunaRegister
 {
@@ -167,11 +199,18 @@ struct ElunaRegister
     typename std::conditional<std::is_same_v<T, void>, int(*)(Eluna*), int(*)(Eluna*, T*)>::type mfunc;
     MethodRegisterState regState;
     MethodFlags flags;
+    // trampoline calling mfunc directly, nullptr for methods called through the thunk
+    lua_CFunction directFunc = nullptr;
 
     // constructor for class methods
     ElunaRegister(const char* name, int(*func)(Eluna*, T*), MethodRegisterState state = METHOD_REG_ALL, uint32 flags = METHOD_FLAG_NONE)
         : name(name), mfunc(func), regState(state), flags(static_cast<MethodFlags>(flags)) {}
 
+    // constructor for class methods with a direct trampoline
+    template<auto Method>
+    ElunaRegister(const char* name, ElunaDirect<Method>, MethodRegisterState state = METHOD_REG_ALL, uint32 flags = METHOD_FLAG_NONE)
+        : name(name), mfunc(Method), regState(state), flags(static_cast<MethodFlags>(flags)), directFunc(&ElunaDirectMethod<T, Method>) {}
+
     // constructor for global methods
     ElunaRegister(const char* name, int(*func)(Eluna*), MethodRegisterState state = METHOD_REG_ALL, uint32 flags = METHOD_FLAG_NONE)
         : name(name), mfunc(func), regState(state), flags(static_cast<MethodFlags>(flags)) {}
@@ -181,12 +220,83 @@ struct ElunaRegister
         : name(name), mfunc(nullptr), regState(state), flags(static_cast<MethodFlags>(flags)) {}
 };
 
+// Returns a new process wide index, used to give every ElunaTemplate type a slot in Eluna::GetTemplateRefs
+uint32 ElunaNextTemplateTypeIndex();
+
 template<typename T = void>
 class ElunaTemplate
 {
 public:
+    // Set once by the first Register, every state registers T with the same name
     static const char* tname;
 
+    static uint32 GetTypeIndex()
+    {
+        static const uint32 typeIndex = ElunaNextTemplateTypeIndex();
+        return typeIndex;
+    }
+
+    // Single bit identifying T in ElunaObject::GetTypeAncestry
+    static uint64 GetTypeBit()
+    {
+        // every registered type needs a bit, or objects of it would fail the checks for their own type
+        ASSERT(GetTypeIndex() < 64);
+        return uint64(1) << GetTypeIndex();
+    }
+
+    // Type bits of T and of its registered base types, computed once so that base class checks are a single mask test
+    static uint64 GetAncestry()
+    {
+        static const uint64 ancestry = ComputeAncestry();
+        return ancestry;
+    }
+
+    // Value types are always copied when pushed, so only reference types can reuse their userdata
+    static constexpr bool IsUserdataCacheable()
+    {
+        return !std::is_base_of_v<ElunaObjectValueImpl<T>, ElunaObjectImpl<T>>;
+    }
+
+    // A method from one of the tables given to SetMethods, type erased so that base class tables can be listed together
+    struct LazyMethod
+    {
+        const char* name;
+        const void* method;
+        void (*push)(Eluna* E, const void* method);
+    };
+
+    // The methods of T sorted by name, built once for all states.
+    // States only create a method's closure when it is first looked up, see LazyIndex.
+    struct MethodIndex
+    {
+        std::shared_mutex lock;
+        std::vector<const void*> tables;
+        std::vector<LazyMethod> methods;
+        // bumped when methods are added, names a state found missing before may exist after that
+        std::atomic<uint32> version { 0 };
+    };
+
+    // Names a state remembers as missing from the method index before the cache is cleared
+    static constexpr int MAX_CACHED_MISSES = 256;
+
+    static uint64 ComputeAncestry()
+    {
+        uint64 ancestry = GetTypeBit();
+        if constexpr (std::is_base_of_v<Object, T> && !std::is_same_v<Object, T>)
+            ancestry |= ElunaTemplate<Object>::GetTypeBit();
+        if constexpr (std::is_base_of_v<WorldObject, T> && !std::is_same_v<WorldObject, T>)
+            ancestry |= ElunaTemplate<WorldObject>::GetTypeBit();
+        if constexpr (std::is_base_of_v<Unit, T> && !std::is_same_v<Unit, T>)
+            ancestry |= ElunaTemplate<Unit>::GetTypeBit();
+        return ancestry;
+    }
+
+    static MethodIndex& GetMethodIndex()
+    {
+        static MethodIndex index;
+        return index;
+    }
+
     // name will be used as type name
     // If gc is true, lua will handle the memory management for object pushed
     // gc should be used if pushing for example WorldPacket,
@@ -205,12 +315,30 @@ public:
         // pop nil
         lua_pop(L, 1);
 
-        tname = name;
+        // states are created on several threads while others push objects, so the name is only written once
+        static std::once_flag nameOnce;
+        std::call_once(nameOnce, [name]() { tname = name; });
+        ASSERT(strcmp(tname, name) == 0);
 
         // create metatable for userdata of this type
         luaL_newmetatable(L, tname);
         int metatable = lua_gettop(L);
 
+        // keep integer references to avoid looking the metatable up by name on every push
+        ElunaTemplateRefs& refs = E->GetTemplateRefs(GetTypeIndex());
+        lua_pushvalue(L, metatable);
+        refs.metatable = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        if (IsUserdataCacheable() && sElunaConfig->IsUserdataCacheEnabled())
+        {
+            lua_newtable(L);
+            lua_newtable(L);
+            lua_pushstring(L, "v");
+            lua_setfield(L, -2, "__mode");
+            lua_setmetatable(L, -2);
+            refs.userdataCache = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+
         // push methodtable to stack to be accessed and modified by users
         lua_pushvalue(L, metatable);
         lua_setglobal(L, tname);
@@ -284,6 +412,14 @@ public:
         lua_pushcfunction(L, GetType);
         lua_setfield(L, metatable, "GetObjectType");
 
+        // methods missing from the metatable are created from the method index and stored in the metatable on first use
+        lua_newtable(L);
+        lua_pushlightuserdata(L, E);
+        lua_pushnil(L);
+        lua_pushcclosure(L, LazyIndex, 2);
+        lua_setfield(L, -2, "__index");
+        lua_setmetatable(L, metatable);
+
         // pop metatable
         lua_pop(L, 1);
     }
@@ -294,84 +430,212 @@ public:
         ASSERT(E);
         ASSERT(methodTable);
 
-        lua_State* L = E->L;
-
         // determine if the method table functions are global or non-global
         constexpr bool isGlobal = std::is_same_v<C, void>;
 
-        if constexpr (isGlobal)
-        {
-            lua_pushglobaltable(L);
-        }
-        else
+        // class methods are only added to the method index, the state creates them when they are used
+        if constexpr (!isGlobal)
         {
             ASSERT(tname);
-
-            // get metatable
-            lua_pushstring(L, tname);
-            lua_rawget(L, LUA_REGISTRYINDEX);
-            ASSERT(lua_istable(L, -1));
+            AddToMethodIndex(methodTable, N);
+            return;
         }
 
+        lua_State* L = E->L;
+        lua_pushglobaltable(L);
+
         // load all core-specific methods
         for (std::size_t i = 0; i < N; i++)
         {
-            const auto& method = methodTable + i;
+            lua_pushstring(L, methodTable[i].name);
+            PushMethod<C>(E, &methodTable[i]);
+            lua_rawset(L, -3);
+        }
+
+        lua_pop(L, 1);
+    }
 
-            // push the method name to the Lua stack
+    // Pushes the function to call for the method, which is an error function if the method can not be used in this state
+    template<typename C>
+    static void PushMethod(Eluna* E, const void* erased)
+    {
+        lua_State* L = E->L;
+        const ElunaRegister<C>* method = static_cast<const ElunaRegister<C>*>(erased);
+
+        // if the method should not be registered, push a closure to error output function
+        if (method->regState == METHOD_REG_NONE)
+        {
+            lua_pushstring(L, method->name);
+            lua_pushcclosure(L, MethodUnimpl, 1);
+            return;
+        }
+
+        // if the method is considered unsafe, and unsafe methods have not been enabled, push a closure to error output function
+        if (method->flags & METHOD_FLAG_UNSAFE && !sElunaConfig->UnsafeMethodsEnabled())
+        {
             lua_pushstring(L, method->name);
+            lua_pushcclosure(L, MethodUnsafe, 1);
+            return;
+        }
+
+        // if the method is considered deprecated, and deprecated methods have not been enabled, push a closure to error output function
+        if (method->flags & METHOD_FLAG_DEPRECATED && !sElunaConfig->DeprecatedMethodsEnabled())
+        {
+            lua_pushstring(L, method->name);
+            lua_pushcclosure(L, MethodDeprecated, 1);
+            return;
+        }
+
+        // if we're in multistate mode, we need to check whether a method is flagged as a world or a map specific method
+        if (method->regState != METHOD_REG_ALL)
+        {
+            int32 mapId = E->GetBoundMapId();
 
             // if the method should not be registered, push a closure to error output function
-            if (method->regState == METHOD_REG_NONE)
+            if ((mapId == -1 && method->regState == METHOD_REG_MAP) ||
+                (mapId != -1 && method->regState == METHOD_REG_WORLD))
             {
                 lua_pushstring(L, method->name);
-                lua_pushcclosure(L, MethodUnimpl, 1);
-                lua_rawset(L, -3);
-                continue;
+                lua_pushinteger(L, mapId);
+                lua_pushcclosure(L, MethodWrongState, 2);
+                return;
             }
+        }
+
+        // methods with a trampoline only need the state
+        if (method->directFunc)
+        {
+            lua_pushlightuserdata(L, E);
+            lua_pushcclosure(L, method->directFunc, 1);
+            return;
+        }
+
+        // push a closure to the thunk with the method pointer and the state as light user data
+        lua_pushlightuserdata(L, (void*)method);
+        lua_pushlightuserdata(L, E);
+        lua_pushcclosure(L, thunk, 2);
+    }
+
+    // Adds a method table to the method index once, every state registers the same tables in the same order
+    template<typename C>
+    static void AddToMethodIndex(ElunaRegister<C> const* methodTable, size_t count)
+    {
+        MethodIndex& index = GetMethodIndex();
+        {
+            std::shared_lock<std::shared_mutex> lock(index.lock);
+            if (std::find(index.tables.begin(), index.tables.end(), methodTable) != index.tables.end())
+                return;
+        }
 
-            // if the method is considered unsafe, and unsafe methods have not been enabled, push a closure to error output function
-            if (method->flags & METHOD_FLAG_UNSAFE && !sElunaConfig->UnsafeMethodsEnabled())
+        std::unique_lock<std::shared_mutex> lock(index.lock);
+        if (std::find(index.tables.begin(), index.tables.end(), methodTable) != index.tables.end())
+            return;
+
+        index.tables.push_back(methodTable);
+        for (size_t i = 0; i < count; ++i)
+        {
+            LazyMethod method = { methodTable[i].name, &methodTable[i], &PushMethod<C> };
+
+            // a method of a later table replaces one with the same name, like setting it in the metatable did
+            auto itr = std::lower_bound(index.methods.begin(), index.methods.end(), method.name,
+                [](const LazyMethod& m, const char* name) { return strcmp(m.name, name) < 0; });
+            if (itr != index.methods.end() && strcmp(itr->name, method.name) == 0)
+                *itr = method;
+            else
+                index.methods.insert(itr, method);
+        }
+        index.version.fetch_add(1, std::memory_order_release);
+    }
+
+    // __index of the metatable's own metatable, creates a method of the index and stores it in the metatable.
+    // Names that are not methods, like fields scripts test for on objects, are remembered per state in the
+    // table of the second upvalue so that repeated lookups don't take the index lock.
+    // The table keeps the index version it was made for at [1] and the amount of names at [2].
+    static int LazyIndex(lua_State* L)
+    {
+        // Stack: metatable, key
+        if (lua_type(L, 2) != LUA_TSTRING)
+            return 0;
+
+        uint32 version = GetMethodIndex().version.load(std::memory_order_acquire);
+        int misses = lua_upvalueindex(2);
+        if (lua_istable(L, misses))
+        {
+            lua_rawgeti(L, misses, 1);
+            bool current = static_cast<uint32>(lua_tonumber(L, -1)) == version;
+            lua_pop(L, 1);
+
+            if (current)
             {
-                lua_pushstring(L, method->name);
-                lua_pushcclosure(L, MethodUnsafe, 1);
-                lua_rawset(L, -3);
-                continue;
+                lua_pushvalue(L, 2);
+                lua_rawget(L, misses);
+                bool missing = lua_toboolean(L, -1);
+                lua_pop(L, 1);
+                if (missing)
+                    return 0;
             }
-
-            // if the method is considered deprecated, and deprecated methods have not been enabled, push a closure to error output function
-            if (method->flags & METHOD_FLAG_DEPRECATED && !sElunaConfig->DeprecatedMethodsEnabled())
+            else
             {
-                lua_pushstring(L, method->name);
-                lua_pushcclosure(L, MethodDeprecated, 1);
-                lua_rawset(L, -3);
-                continue;
+                lua_pushnil(L);
+                lua_replace(L, misses);
             }
+        }
 
-            // if we're in multistate mode, we need to check whether a method is flagged as a world or a map specific method
-            if (method->regState != METHOD_REG_ALL)
+        const char* name = lua_tostring(L, 2);
+        LazyMethod method;
+        {
+            MethodIndex& index = GetMethodIndex();
+            std::shared_lock<std::shared_mutex> lock(index.lock);
+
+            auto itr = std::lower_bound(index.methods.begin(), index.methods.end(), name,
+                [](const LazyMethod& m, const char* key) { return strcmp(m.name, key) < 0; });
+            if (itr == index.methods.end() || strcmp(itr->name, name) != 0)
             {
-                int32 mapId = E->GetBoundMapId();
-
-                // if the method should not be registered, push a closure to error output function
-                if ((mapId == -1 && method->regState == METHOD_REG_MAP) ||
-                    (mapId != -1 && method->regState == METHOD_REG_WORLD))
-                {
-                    lua_pushstring(L, method->name);
-                    lua_pushinteger(L, mapId);
-                    lua_pushcclosure(L, MethodWrongState, 2);
-                    lua_rawset(L, -3);
-                    continue;
-                }
+                lock.unlock();
+                RememberMiss(L, version);
+                return 0;
             }
 
-            // push a closure to the thunk with the method pointer as light user data
-            lua_pushlightuserdata(L, (void*)method);
-            lua_pushcclosure(L, thunk, 1);
-            lua_rawset(L, -3);
+            method = *itr;
         }
 
-        lua_pop(L, 1);
+        Eluna* E = static_cast<Eluna*>(lua_touserdata(L, lua_upvalueindex(1)));
+        method.push(E, method.method);
+        // Stack: metatable, key, function
+
+        lua_pushvalue(L, 2);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, 1);
+        return 1;
+    }
+
+    // Adds the key at index 2 to the missing names of LazyIndex, starting over when the table is full
+    static void RememberMiss(lua_State* L, uint32 version)
+    {
+        int misses = lua_upvalueindex(2);
+        int count = 0;
+        if (lua_istable(L, misses))
+        {
+            lua_rawgeti(L, misses, 2);
+            count = static_cast<int>(lua_tonumber(L, -1));
+            lua_pop(L, 1);
+        }
+
+        if (!lua_istable(L, misses) || count >= MAX_CACHED_MISSES)
+        {
+            lua_newtable(L);
+            lua_pushnumber(L, version);
+            lua_rawseti(L, -2, 1);
+            lua_replace(L, misses);
+            count = 0;
+        }
+
+        lua_pushvalue(L, 2);
+        lua_pushboolean(L, 1);
+        lua_rawset(L, misses);
+
+        lua_pushnumber(L, count + 1);
+        lua_rawseti(L, misses, 2);
     }
 
     static int Push(Eluna* E, T const* obj)
@@ -385,56 +649,103 @@ public:
 
         typedef ElunaObjectImpl<T> ElunaObjectType;
 
+        const ElunaTemplateRefs& refs = E->GetTemplateRefs(GetTypeIndex());
+        int top = lua_gettop(L);
+
+        // Reuse the userdata pushed earlier for this object while it still refers to it
+        int cache = 0;
+        if (refs.userdataCache != LUA_NOREF)
+        {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, refs.userdataCache);
+            cache = lua_gettop(L);
+
+            lua_pushlightuserdata(L, const_cast<T*>(obj));
+            lua_rawget(L, cache);
+            ElunaObject* cached = static_cast<ElunaObject*>(lua_touserdata(L, -1));
+            if (cached && cached->GetObjIfValid() == obj)
+            {
+                lua_remove(L, cache);
+                return 1;
+            }
+            lua_pop(L, 1);
+        }
+
         // Create new userdata
         ElunaObjectType* elunaObject = static_cast<ElunaObjectType*>(lua_newuserdata(L, sizeof(ElunaObjectType)));
         if (!elunaObject)
         {
             ELUNA_LOG_ERROR("%s could not create new userdata", tname);
+            lua_settop(L, top);
             lua_pushnil(L);
             return 1;
         }
-        new (elunaObject) ElunaObjectType(E, const_cast<T*>(obj), tname);
+        new (elunaObject) ElunaObjectType(E, const_cast<T*>(obj), tname, GetTypeIndex(), GetAncestry());
 
         // Set metatable for it
-        lua_pushstring(L, tname);
-        lua_rawget(L, LUA_REGISTRYINDEX);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, refs.metatable);
         if (!lua_istable(L, -1))
         {
             ELUNA_LOG_ERROR("%s missing metatable", tname);
-            lua_pop(L, 2);
+            lua_settop(L, top);
             lua_pushnil(L);
             return 1;
         }
         lua_setmetatable(L, -2);
+
+        if (cache)
+        {
+            lua_pushlightuserdata(L, const_cast<T*>(obj));
+            lua_pushvalue(L, -2);
+            lua_rawset(L, cache);
+            lua_remove(L, cache);
+        }
         return 1;
     }
 
     static T* Check(Eluna* E, int narg, bool error = true)
     {
-        lua_State* L = E->L;
-
-        ElunaObject* elunaObj = E->CHECKTYPE(narg, tname, error);
+        ElunaObject* elunaObj = E->CHECKTYPE(narg, tname, GetTypeIndex(), 0, error);
         if (!elunaObj)
             return NULL;
 
         void* obj = elunaObj->GetObjIfValid();
         if (!obj)
-        {
-            char buff[256];
-            snprintf(buff, 256, "%s expected, got pointer to nonexisting (invalidated) object (%s). Check your code.", tname, luaL_typename(L, narg));
-            if (error)
-            {
-                luaL_argerror(L, narg, buff);
-            }
-            else
-            {
-                ELUNA_LOG_ERROR("%s", buff);
-            }
+            return InvalidObject(E, narg, error);
+        return static_cast<T*>(obj);
+    }
+
+    // Same as Check, but also accepts objects of any registered type derived from T
+    static T* CheckDerived(Eluna* E, int narg, bool error = true)
+    {
+        static_assert(std::is_base_of_v<Object, T>, "only Object types are pushed as derived types");
+
+        ElunaObject* elunaObj = E->CHECKTYPE(narg, tname, GetTypeIndex(), GetTypeBit(), error);
+        if (!elunaObj)
             return NULL;
-        }
+
+        Object* obj = elunaObj->GetBaseObjIfValid();
+        if (!obj)
+            return InvalidObject(E, narg, error);
         return static_cast<T*>(obj);
     }
 
+    static T* InvalidObject(Eluna* E, int narg, bool error)
+    {
+        lua_State* L = E->L;
+
+        char buff[256];
+        snprintf(buff, 256, "%s expected, got pointer to nonexisting (invalidated) object (%s). Check your code.", tname, luaL_typename(L, narg));
+        if (error)
+        {
+            luaL_argerror(L, narg, buff);
+        }
+        else
+        {
+            ELUNA_LOG_ERROR("%s", buff);
+        }
+        return NULL;
+    }
+
     static int GetType(lua_State* L)
     {
         lua_pushstring(L, tname);
@@ -444,7 +755,7 @@ public:
     static int thunk(lua_State* L)
     {
         ElunaRegister<T>* l = static_cast<ElunaRegister<T>*>(lua_touserdata(L, lua_upvalueindex(1)));
-        Eluna* E = Eluna::GetEluna(L);
+        Eluna* E = static_cast<Eluna*>(lua_touserdata(L, lua_upvalueindex(2)));
 
         // determine if the method table functions are global or non-global
         constexpr bool isGlobal = std::is_same_v<T, void>;
@@ -466,13 +777,19 @@ public:
         else
             expected = l->mfunc(E, obj); // non-global method
 
+        // only fix up the stack if the method pushed fewer values than it returns
         int args = lua_gettop(L) - top;
-        if (args < 0 || args > expected)
+        if (args != expected)
         {
-            ELUNA_LOG_ERROR("[Eluna]: %s returned unexpected amount of arguments %i out of %i. Report to devs", l->name, args, expected);
-            ASSERT(false);
+#if defined ELUNA_DEBUG
+            if (args < 0 || args > expected)
+            {
+                ELUNA_LOG_ERROR("[Eluna]: %s returned unexpected amount of arguments %i out of %i. Report to devs", l->name, args, expected);
+                ASSERT(false);
+            }
+#endif
+            lua_settop(L, top + expected);
         }
-        lua_settop(L, top + expected);
         return expected;
     }
 
@@ -522,4 +839,27 @@ public:
 
 template<typename T> const char* ElunaTemplate<T>::tname = NULL;
 
+template<typename T, int(*Method)(Eluna*, T*)>
+int ElunaDirectMethod(lua_State* L)
+{
+    Eluna* E = static_cast<Eluna*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    T* obj = E->CHECKOBJ<T>(1);
+    if (!obj)
+        return 0;
+
+#if defined ELUNA_DEBUG
+    int top = lua_gettop(L);
+    int expected = Method(E, obj);
+    if (lua_gettop(L) - top != expected)
+    {
+        ELUNA_LOG_ERROR("[Eluna]: direct method returned %i values but pushed %i. Report to devs", expected, lua_gettop(L) - top);
+        ASSERT(false);
+    }
+    return expected;
+#else
+    return Method(E, obj);
+#endif
+}
+
 #endif
@@ -39,6 +39,11 @@
 #define USING_BOOST
 #endif
 
+// Extra sanity checks on the Lua <-> C++ boundary, only for debug builds of the core
+#if defined TRINITY_DEBUG || defined ACORE_DEBUG || defined _DEBUG
+#define ELUNA_DEBUG
+#endif
+
 #if defined TRINITY_PLATFORM && defined TRINITY_PLATFORM_WINDOWS
 #if TRINITY_PLATFORM == TRINITY_PLATFORM_WINDOWS
 #define ELUNA_WINDOWS
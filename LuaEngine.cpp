@@ -12,11 +12,16 @@
 #include "ElunaEventMgr.h"
 #include "ElunaIncludes.h"
 #include "ElunaLoader.h"
+#include "ElunaMgr.h"
 #include "ElunaTemplate.h"
 #include "ElunaUtility.h"
 #include "ElunaCreatureAI.h"
 #include "ElunaInstanceAI.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 extern "C"
 {
 // Base lua libraries
@@ -29,6 +34,18 @@ extern "C"
 
 extern void RegisterMethods(Eluna* E);
 
+// Memory used by the Lua state in bytes
+static int64 GetLuaMemory(lua_State* L)
+{
+    return int64(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+static int LuaPanic(lua_State* L)
+{
+    ELUNA_LOG_ERROR("[Eluna]: PANIC: unprotected error in call to Lua API (%s)", lua_tostring(L, -1));
+    return 0;
+}
+
 void Eluna::_ReloadEluna()
 {
     // Remove all timed events
@@ -51,10 +68,79 @@ void Eluna::_ReloadEluna()
     reload = false;
 }
 
-Eluna::Eluna(Map* map) :
+Eluna* Eluna::SwapInReplacement()
+{
+    if (!replacementState.valid())
+    {
+        Map* map = boundMap;
+        ELUNA_LOG_DEBUG("[Eluna]: Creating the replacement state for map: %i, instance: %u", GetBoundMapId(), GetBoundInstanceId());
+        replacementState = std::async(std::launch::async, [map]() { return std::make_unique<Eluna>(map, true); });
+        return nullptr;
+    }
+
+    if (replacementState.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return nullptr;
+
+    std::unique_ptr<Eluna> state = replacementState.get();
+    Eluna* E = state.get();
+
+    // the managers are only swapped once the replacement is in place, until then it still owns its own
+    if (!sElunaMgr->Replace(this, state))
+    {
+        // not a managed state, reload in place instead
+        state.reset();
+        _ReloadEluna();
+        return nullptr;
+    }
+    // `state` now holds this state, the replacement owns it from here on
+
+    // the scripts were reloaded again while the replacement was created
+    if (E->scriptCache != sElunaLoader->GetScriptCache())
+        E->reload = true;
+
+    // objects keep pointers to the event manager, so the replacement takes over this one with the events its scripts created
+    eventMgr->SetAllEventStates(LUAEVENT_STATE_ERASE);
+    eventMgr->MoveGlobalEvents(*E->eventMgr);
+    std::swap(eventMgr, E->eventMgr);
+    eventMgr->SetEluna(this);
+    E->eventMgr->SetEluna(E);
+
+    reload = false;
+
+    ELUNA_LOG_DEBUG("[Eluna]: Swapped in the replacement state for map: %i, instance: %u", GetBoundMapId(), GetBoundInstanceId());
+    E->retiredState = std::move(state);
+
+    // the open handlers usually access the map and its players, so they run on the map's thread instead of the worker
+    E->deferStateOpen = false;
+    if (E->stateOpenPending)
+    {
+        E->stateOpenPending = false;
+        E->OnLuaStateOpen();
+    }
+    return E;
+}
+
+void Eluna::UpdateRetiredState()
+{
+    if (!retiredState)
+        return;
+
+#if defined ELUNA_TRINITY
+    // the old state runs the callbacks of its async queries before it is closed
+    QueryCallbackProcessor& queries = retiredState->GetQueryProcessor();
+    queries.ProcessReadyCallbacks();
+    if (!queries.Empty())
+        return;
+#endif
+
+    retiredState.reset();
+}
+
+Eluna::Eluna(Map* map, bool deferStateOpen) :
 event_level(0),
 push_counter(0),
 boundMap(map),
+deferStateOpen(deferStateOpen),
 L(NULL)
 {
     OpenLua();
@@ -69,6 +155,10 @@ L(NULL)
 
 Eluna::~Eluna()
 {
+    // the replacement state may still be running scripts for the map
+    if (replacementState.valid())
+        replacementState.wait();
+
     CloseLua();
 }
 
@@ -76,12 +166,21 @@ void Eluna::CloseLua()
 {
     OnLuaStateClose();
 
+    ElunaEventPoolStats const& poolStats = eventMgr->GetEventPoolStats();
+    ELUNA_LOG_DEBUG("[Eluna]: Timed event pool of map: %i, instance: %u had %u live and %u peak events in %u slots after %llu allocations",
+        GetBoundMapId(), GetBoundInstanceId(), poolStats.live, poolStats.peak, poolStats.capacity, static_cast<unsigned long long>(poolStats.allocs));
+
     DestroyBindStores();
 
     // Must close lua state after deleting stores and mgr
     if (L)
         lua_close(L);
     L = NULL;
+    allocator.reset();
+
+    templateRefs.clear();
+    scriptProfiles.clear();
+    scriptCache.reset();
 
     instanceDataRefs.clear();
     continentDataRefs.clear();
@@ -93,14 +192,14 @@ static int PrecompiledLoader(lua_State* L)
     if (modname == NULL)
         return 0;
 
-    const std::vector<LuaScript>& scripts = sElunaLoader->GetLuaScripts();
+    const ScriptCache* cache = Eluna::GetEluna(L)->GetScriptCache();
 
-    auto it = std::find_if(scripts.begin(), scripts.end(), [modname](const LuaScript& script) { return script.filename == modname; });
-    if (it == scripts.end()) {
+    const LuaScript* it = cache ? cache->FindModule(modname) : nullptr;
+    if (!it) {
         lua_pushfstring(L, "\n\tno precompiled script '%s' found", modname);
         return 1;
     }
-    if (luaL_loadbuffer(L, reinterpret_cast<const char*>(&it->bytecode[0]), it->bytecode.size(), it->filename.c_str()))
+    if (luaL_loadbuffer(L, cache->GetBytecode(*it), it->bytecodeSize, it->filename.c_str()))
     {
         // Stack: modname, errmsg
         return lua_error(L);
@@ -113,31 +212,67 @@ static int PrecompiledLoader(lua_State* L)
 
 void Eluna::OpenLua()
 {
-    L = luaL_newstate();
+    allocator = std::make_unique<ElunaAllocator>();
+    L = lua_newstate(&ElunaAllocator::Alloc, allocator.get());
+    if (L)
+        lua_atpanic(L, &LuaPanic);
+    else
+    {
+        // LuaJIT on 64 bit targets without GC64 only creates states with its own allocator
+        allocator.reset();
+        L = luaL_newstate();
+    }
 
+#if LUA_VERSION_NUM >= 503
+    static_assert(LUA_EXTRASPACE >= sizeof(Eluna*), "lua_getextraspace is too small to hold the state pointer");
+    *static_cast<Eluna**>(lua_getextraspace(L)) = this;
+#else
+    lua_pushlightuserdata(L, const_cast<char*>(&StateKey));
     lua_pushlightuserdata(L, this);
-    lua_setfield(L, LUA_REGISTRYINDEX, ELUNA_STATE_PTR);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+#endif
 
     CreateBindStores();
 
     // open base lua libraries
     luaL_openlibs(L);
 
+#if defined LUAJIT_VERSION
+    // optimization level of the trace compiler, LuaJIT bytecode is the same for every level
+    uint32 jitOptLevel = std::min<uint32>(sElunaConfig->GetConfig(CONFIG_ELUNA_JIT_OPT_LEVEL), 3);
+    if (jitOptLevel != 3)
+    {
+        std::string jitOpt = "jit.opt.start(" + std::to_string(jitOptLevel) + ")";
+        if (luaL_dostring(L, jitOpt.c_str()))
+            Report(L);
+    }
+#endif
+
     // Register methods and functions
     RegisterMethods(this);
 
+    // the limits only apply to what the scripts allocate, the libraries and methods are always registered
+    if (allocator)
+        allocator->SetLimits(uint64(sElunaConfig->GetConfig(CONFIG_ELUNA_MEMORY_SOFT_LIMIT)) * 1024 * 1024,
+            uint64(sElunaConfig->GetConfig(CONFIG_ELUNA_MEMORY_HARD_LIMIT)) * 1024 * 1024);
+
+#if LUA_VERSION_NUM >= 504
+    if (sElunaConfig->GetConfig(CONFIG_ELUNA_GC_GENERATIONAL))
+        lua_gc(L, LUA_GCGEN, 0, 0);
+#endif
+    gcStepThreshold = 0;
+
     // Register event ID lookup table
     RegisterHookGlobals(L);
 
-    // get require paths
-    const std::string& requirepath = sElunaLoader->GetRequirePath();
-    const std::string& requirecpath = sElunaLoader->GetRequireCPath();
+    // pin the current script cache, it is kept until the state is closed
+    scriptCache = sElunaLoader->GetScriptCache();
 
     // Set lua require folder paths (scripts folder structure)
     lua_getglobal(L, "package");
-    lua_pushstring(L, requirepath.c_str());
+    lua_pushstring(L, scriptCache ? scriptCache->requirePath.c_str() : "");
     lua_setfield(L, -2, "path");
-    lua_pushstring(L, requirecpath.c_str());
+    lua_pushstring(L, scriptCache ? scriptCache->requirecPath.c_str() : "");
     lua_setfield(L, -2, "cpath");
     // Set package.loaders loader for precompiled scripts
     lua_getfield(L, -1, "loaders");
@@ -161,32 +296,12 @@ void Eluna::CreateBindStores()
 {
     DestroyBindStores();
 
-    CreateBinding<EventKey<Hooks::ServerEvents>>(Hooks::REGTYPE_SERVER);
-    CreateBinding<EventKey<Hooks::PlayerEvents>>(Hooks::REGTYPE_PLAYER);
-    CreateBinding<EventKey<Hooks::GuildEvents>>(Hooks::REGTYPE_GUILD);
-    CreateBinding<EventKey<Hooks::GroupEvents>>(Hooks::REGTYPE_GROUP);
-    CreateBinding<EventKey<Hooks::VehicleEvents>>(Hooks::REGTYPE_VEHICLE);
-    CreateBinding<EventKey<Hooks::BGEvents>>(Hooks::REGTYPE_BG);
-
-    CreateBinding<EntryKey<Hooks::PacketEvents>>(Hooks::REGTYPE_PACKET);
-    CreateBinding<EntryKey<Hooks::CreatureEvents>>(Hooks::REGTYPE_CREATURE);
-    CreateBinding<EntryKey<Hooks::GossipEvents>>(Hooks::REGTYPE_CREATURE_GOSSIP);
-    CreateBinding<EntryKey<Hooks::GameObjectEvents>>(Hooks::REGTYPE_GAMEOBJECT);
-    CreateBinding<EntryKey<Hooks::GossipEvents>>(Hooks::REGTYPE_GAMEOBJECT_GOSSIP);
-    CreateBinding<EntryKey<Hooks::SpellEvents>>(Hooks::REGTYPE_SPELL);
-    CreateBinding<EntryKey<Hooks::ItemEvents>>(Hooks::REGTYPE_ITEM);
-    CreateBinding<EntryKey<Hooks::GossipEvents>>(Hooks::REGTYPE_ITEM_GOSSIP);
-    CreateBinding<EntryKey<Hooks::GossipEvents>>(Hooks::REGTYPE_PLAYER_GOSSIP);
-    CreateBinding<EntryKey<Hooks::InstanceEvents>>(Hooks::REGTYPE_MAP);
-    CreateBinding<EntryKey<Hooks::InstanceEvents>>(Hooks::REGTYPE_INSTANCE);
-
-    CreateBinding<UniqueObjectKey<Hooks::CreatureEvents>>(Hooks::REGTYPE_CREATURE_UNIQUE);
+    CreateBindings(std::make_index_sequence<Hooks::REGTYPE_COUNT>());
 }
 
 void Eluna::DestroyBindStores()
 {
-    for (auto& binding : bindingMaps)
-        binding.reset();
+    std::apply([](auto&... bindings) { (bindings.reset(), ...); }, bindingStores);
 }
 
 void Eluna::RegisterHookGlobals(lua_State* _L)
@@ -215,24 +330,30 @@ void Eluna::RunScripts()
     uint32 const boundInstanceId = GetBoundInstanceId();
     ELUNA_LOG_DEBUG("[Eluna]: Running scripts for state: %i, instance: %u", boundMapId, boundInstanceId);
 
+    // the cache was published after this state was opened, load it on the next update instead
+    if (!scriptCache)
+    {
+        reload = true;
+        return;
+    }
+
     uint32 oldMSTime = ElunaUtil::GetCurrTime();
     uint32 count = 0;
 
     std::unordered_map<std::string, std::string> loaded; // filename, path
 
+    const std::vector<size_t>& scripts = scriptCache->GetScriptsForMap(boundMapId);
+    scriptProfiles.clear();
+    scriptProfiles.reserve(scripts.size());
+    loadingScripts = true;
+
     lua_getglobal(L, "require");
     // Stack: require
 
-    const std::vector<LuaScript>& scripts = sElunaLoader->GetLuaScripts();
-
-    for (auto it = scripts.begin(); it != scripts.end(); ++it)
+    // only the scripts that are either global or meant to be loaded for this map
+    for (size_t index : scripts)
     {
-        // check that the script file is either global or meant to be loaded for this map
-        if (it->mapId != -1 && it->mapId != boundMapId)
-        {
-            ELUNA_LOG_DEBUG("[Eluna]: `%s` is tagged %i and will not load for map: %i", it->filename.c_str(), it->mapId, boundMapId);
-            continue;
-        }
+        const LuaScript* it = &scriptCache->scripts[index];
 
         // Check that no duplicate names exist
         if (loaded.find(it->filename) != loaded.end())
@@ -247,7 +368,14 @@ void Eluna::RunScripts()
         // The loader is set up in Eluna::OpenLua
         lua_pushvalue(L, -1); // Stack: require, require
         lua_pushstring(L, it->filename.c_str()); // Stack: require, require, filename
-        if (ExecuteCall(1, 0))
+
+        int64 memoryBefore = GetLuaMemory(L);
+        auto start = std::chrono::steady_clock::now();
+        bool success = ExecuteCall(1, 0);
+        uint64 requireTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        scriptProfiles.push_back({ index, requireTime, GetLuaMemory(L) - memoryBefore });
+
+        if (success)
         {
             // Successfully called require on the script
             ELUNA_LOG_DEBUG("[Eluna]: Successfully loaded `%s`", it->filepath.c_str());
@@ -258,9 +386,145 @@ void Eluna::RunScripts()
     }
     // Stack: require
     lua_pop(L, 1);
+    loadingScripts = false;
     ELUNA_LOG_INFO("[Eluna]: Executed %u Lua scripts in %u ms for map: %i, instance: %u", count, ElunaUtil::GetTimeDiff(oldMSTime), boundMapId, boundInstanceId);
 
-    OnLuaStateOpen();
+    if (uint32 reportSize = sElunaConfig->GetConfig(CONFIG_ELUNA_LOAD_REPORT_SIZE))
+        LogScriptLoadReport(reportSize);
+
+    if (deferStateOpen)
+        stateOpenPending = true;
+    else
+        OnLuaStateOpen();
+}
+
+// the profiles sorted by require time, slowest first
+static std::vector<const ScriptRunProfile*> SortScriptProfiles(const std::vector<ScriptRunProfile>& profiles)
+{
+    std::vector<const ScriptRunProfile*> sorted;
+    sorted.reserve(profiles.size());
+    for (const ScriptRunProfile& profile : profiles)
+        sorted.push_back(&profile);
+
+    std::sort(sorted.begin(), sorted.end(), [](const ScriptRunProfile* a, const ScriptRunProfile* b) { return a->requireTime > b->requireTime; });
+    return sorted;
+}
+
+void Eluna::LogScriptLoadReport(uint32 count) const
+{
+    std::vector<const ScriptRunProfile*> sorted = SortScriptProfiles(scriptProfiles);
+    if (sorted.size() > count)
+        sorted.resize(count);
+
+    ELUNA_LOG_INFO("[Eluna]: Slowest %u scripts to run for map: %i, instance: %u", uint32(sorted.size()), GetBoundMapId(), GetBoundInstanceId());
+    for (const ScriptRunProfile* profile : sorted)
+    {
+        const LuaScript& script = scriptCache->scripts[profile->script];
+        ELUNA_LOG_INFO("[Eluna]:   `%s`: %.2f ms to run, %.2f ms to compile, %u bytes of bytecode, %lld bytes of Lua memory",
+            script.filepath.c_str(), profile->requireTime / 1000.0, script.compileTime / 1000.0, uint32(script.bytecodeSize), static_cast<long long>(profile->memoryDelta));
+    }
+}
+
+void Eluna::PushScriptLoadReport()
+{
+    std::vector<const ScriptRunProfile*> sorted = SortScriptProfiles(scriptProfiles);
+
+    lua_createtable(L, int(sorted.size()), 0);
+    int i = 0;
+    for (const ScriptRunProfile* profile : sorted)
+    {
+        const LuaScript& script = scriptCache->scripts[profile->script];
+
+        lua_createtable(L, 0, 6);
+        Push(script.filename);
+        lua_setfield(L, -2, "name");
+        Push(script.filepath);
+        lua_setfield(L, -2, "path");
+        Push(profile->requireTime / 1000.0);
+        lua_setfield(L, -2, "runTime");
+        Push(script.compileTime / 1000.0);
+        lua_setfield(L, -2, "compileTime");
+        Push(uint32(script.bytecodeSize));
+        lua_setfield(L, -2, "bytecodeSize");
+        lua_pushnumber(L, static_cast<lua_Number>(profile->memoryDelta));
+        lua_setfield(L, -2, "memory");
+
+        lua_rawseti(L, -2, ++i);
+    }
+}
+
+ElunaMemoryStats Eluna::GetMemoryStats() const
+{
+    if (allocator)
+        return allocator->GetStats();
+
+    ElunaMemoryStats stats;
+    if (L)
+        stats.live = GetLuaMemory(L);
+    return stats;
+}
+
+void Eluna::PushMemoryStats()
+{
+    ElunaMemoryStats stats = GetMemoryStats();
+
+    lua_createtable(L, 0, 6);
+    Push(double(stats.live));
+    lua_setfield(L, -2, "live");
+    Push(double(stats.peak));
+    lua_setfield(L, -2, "peak");
+    Push(double(stats.pooled));
+    lua_setfield(L, -2, "pooled");
+    Push(double(stats.softLimit));
+    lua_setfield(L, -2, "softLimit");
+    Push(double(stats.hardLimit));
+    lua_setfield(L, -2, "hardLimit");
+    Push(double(stats.failedAllocations));
+    lua_setfield(L, -2, "failedAllocations");
+}
+
+void Eluna::PushEventPoolStats()
+{
+    ElunaEventPoolStats const& stats = eventMgr->GetEventPoolStats();
+
+    lua_createtable(L, 0, 5);
+    Push(stats.live);
+    lua_setfield(L, -2, "live");
+    Push(stats.peak);
+    lua_setfield(L, -2, "peak");
+    Push(stats.capacity);
+    lua_setfield(L, -2, "capacity");
+    Push(double(stats.allocs));
+    lua_setfield(L, -2, "allocs");
+    Push(double(stats.frees));
+    lua_setfield(L, -2, "frees");
+}
+
+void Eluna::UpdateMemoryLimit(uint32 diff)
+{
+    if (!allocator)
+        return;
+
+    if (memoryCollectCooldown > diff)
+    {
+        memoryCollectCooldown -= diff;
+        return;
+    }
+    memoryCollectCooldown = 0;
+
+    if (!allocator->TakeSoftLimitReached())
+        return;
+
+    uint64 before = allocator->GetStats().live;
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    ElunaMemoryStats stats = allocator->GetStats();
+
+    ELUNA_LOG_ERROR("[Eluna]: Lua memory of map: %i, instance: %u went over the soft limit of %llu KB, collected garbage from %llu KB down to %llu KB",
+        GetBoundMapId(), GetBoundInstanceId(), static_cast<unsigned long long>(stats.softLimit / 1024),
+        static_cast<unsigned long long>(before / 1024), static_cast<unsigned long long>(stats.live / 1024));
+
+    // a state staying around the limit collects at most this often
+    memoryCollectCooldown = 5000;
 }
 
 #if !defined TRACKABLE_PTR_NAMESPACE
@@ -301,13 +565,225 @@ int Eluna::StackTrace(lua_State* _L)
     lua_pushvalue(_L, -3);  /* pass error message */
     lua_pushinteger(_L, 1);  /* skip this function and traceback */
     // Stack: errmsg, debug, traceback, errmsg, 2
-    lua_call(_L, 2, 1);  /* call debug.traceback */
+
+    // debug.traceback can be Lua code, the watchdog does not abort it so that the error message is not lost
+    Eluna* E = GetEluna(_L);
+    bool wasInMessageHandler = E->inMessageHandler;
+    E->inMessageHandler = true;
+    int err = lua_pcall(_L, 2, 1, 0);  /* call debug.traceback */
+    E->inMessageHandler = wasInMessageHandler;
+    if (err)
+    {
+        // keep the original message if the traceback failed
+        lua_pop(_L, 2);
+        return 1;
+    }
 
     // dirty stack?
     // Stack: errmsg, debug, tracemsg
     return 1;
 }
 
+void Eluna::ReportCallError()
+{
+    uint32 interval = sElunaConfig->GetConfig(CONFIG_ELUNA_ERROR_LOG_INTERVAL);
+    if (!interval)
+    {
+        Report(L);
+        return;
+    }
+
+    // Stack: errmsg
+    const char* msg = lua_tostring(L, -1);
+    std::string message = msg ? msg : "(error object is not a string)";
+    lua_pop(L, 1);
+
+    uint32 now = ElunaUtil::GetCurrTime();
+    auto [itr, inserted] = errorLog.try_emplace(message, ErrorLogEntry{ now, 0 });
+    if (!inserted)
+    {
+        if (now - itr->second.lastLogged < interval)
+        {
+            ++itr->second.suppressed;
+            return;
+        }
+
+        if (itr->second.suppressed)
+        {
+            ELUNA_LOG_ERROR("%s\n[Eluna]: The error above happened %u more times in the last %u ms", message.c_str(), itr->second.suppressed, now - itr->second.lastLogged);
+            itr->second = { now, 0 };
+            return;
+        }
+        itr->second = { now, 0 };
+    }
+    ELUNA_LOG_ERROR("%s", message.c_str());
+
+    // messages not repeated within the interval are forgotten, after logging how often they were repeated
+    if (errorLog.size() < 256)
+        return;
+
+    for (auto entry = errorLog.begin(); entry != errorLog.end();)
+    {
+        if (now - entry->second.lastLogged < interval)
+        {
+            ++entry;
+            continue;
+        }
+
+        if (entry->second.suppressed)
+            ELUNA_LOG_ERROR("[Eluna]: This error happened %u more times after it was logged:\n%s", entry->second.suppressed, entry->first.c_str());
+        entry = errorLog.erase(entry);
+    }
+}
+
+void Eluna::OnHandlerError(int handlers_index, int function_index)
+{
+    uint32 maxErrors = sElunaConfig->GetConfig(CONFIG_ELUNA_QUARANTINE_ERRORS);
+    if (!maxErrors)
+        return;
+
+    // Stack: ..., handlers, ..., [nils]
+    lua_rawgeti(L, handlers_index, 0);
+    BindingMapBase* bindings = static_cast<BindingMapBase*>(lua_touserdata(L, -1));
+    lua_rawgeti(L, handlers_index, -function_index);
+    uint64 id = static_cast<uint64>(lua_tonumber(L, -1));
+    lua_pop(L, 2);
+    if (!bindings)
+        return;
+
+    uint32 window = sElunaConfig->GetConfig(CONFIG_ELUNA_QUARANTINE_WINDOW);
+    uint32 duration = bindings->RecordError(id, maxErrors, window, sElunaConfig->GetConfig(CONFIG_ELUNA_QUARANTINE_TIME));
+    if (!duration)
+        return;
+
+    lua_Debug ar;
+    lua_rawgeti(L, handlers_index, function_index);
+    lua_getinfo(L, ">S", &ar);
+    ELUNA_LOG_ERROR("[Eluna]: Quarantined the handler defined at %s:%d for %u ms after %u errors within %u ms on map: %i, instance: %u",
+        ar.short_src, ar.linedefined, duration, maxErrors, window, GetBoundMapId(), GetBoundInstanceId());
+}
+
+uint32 Eluna::ReleaseQuarantinedHandlers(uint32 regtype, uint64 id)
+{
+    uint32 released = 0;
+    // the stores are in register type order
+    uint32 type = 0;
+    std::apply([&](auto&... bindings)
+    {
+        ((released += bindings && (regtype == Hooks::REGTYPE_COUNT || regtype == type) ? bindings->ReleaseQuarantines(id) : 0, ++type), ...);
+    }, bindingStores);
+    return released;
+}
+
+void Eluna::PushQuarantinedHandlers()
+{
+    lua_newtable(L);
+    int tbl = lua_gettop(L);
+    int i = 0;
+    uint32 now = ElunaUtil::GetCurrTime();
+
+    auto push = [&](uint32 regtype, uint32 event_id, const Binding& binding)
+    {
+        lua_createtable(L, 0, 6);
+        Push(regtype);
+        lua_setfield(L, -2, "regtype");
+        Push(binding.id);
+        lua_setfield(L, -2, "id");
+        Push(event_id);
+        lua_setfield(L, -2, "event");
+
+        lua_Debug ar;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, binding.functionReference);
+        lua_getinfo(L, ">S", &ar);
+        Push(std::string(ar.short_src) + ":" + std::to_string(ar.linedefined));
+        lua_setfield(L, -2, "source");
+
+        Push(binding.quarantines);
+        lua_setfield(L, -2, "quarantines");
+        int32 remaining = static_cast<int32>(binding.quarantinedUntil - now);
+        Push(remaining > 0 ? uint32(remaining) : 0u);
+        lua_setfield(L, -2, "remainingTime");
+
+        lua_rawseti(L, tbl, ++i);
+    };
+    // the stores are in register type order
+    uint32 regtype = 0;
+    std::apply([&](auto&... bindings)
+    {
+        ((bindings ? bindings->ForEachQuarantined([&](auto event_id, const Binding& binding) { push(regtype, static_cast<uint32>(event_id), binding); }) : void(), ++regtype), ...);
+    }, bindingStores);
+}
+
+bool Eluna::StartWatchdog()
+{
+    uint32 budget = sElunaConfig->GetConfig(loadingScripts ? CONFIG_ELUNA_WATCHDOG_LOAD_TIME : CONFIG_ELUNA_WATCHDOG_CALL_TIME);
+    if (!budget)
+        return false;
+
+    // a hook set by a script with debug.sethook is left alone
+    lua_Hook hook = lua_gethook(L);
+    if (hook && hook != &WatchdogHook)
+        return false;
+
+    watchdogActive = true;
+    watchdogTriggered = false;
+    watchdogBudget = budget;
+    watchdogDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget);
+
+    // the time is checked every this many instructions
+    lua_sethook(L, &WatchdogHook, LUA_MASKCOUNT, 10000);
+    return true;
+}
+
+void Eluna::StopWatchdog()
+{
+    watchdogActive = false;
+    if (lua_gethook(L) == &WatchdogHook)
+        lua_sethook(L, NULL, 0, 0);
+}
+
+void Eluna::WatchdogHook(lua_State* _L, lua_Debug* /*ar*/)
+{
+    Eluna* E = GetEluna(_L);
+    if (!E->watchdogActive || E->inMessageHandler || std::chrono::steady_clock::now() < E->watchdogDeadline)
+        return;
+
+    // the deadline stays passed, so a call that catches the error is aborted again at the next check without logging again
+    if (!E->watchdogTriggered)
+    {
+        E->watchdogTriggered = true;
+
+        // the function the call started with is the deepest Lua function on the stack
+        std::string binding = "?";
+        std::string traceback;
+        lua_Debug frame;
+        for (int level = 0; lua_getstack(_L, level, &frame); ++level)
+        {
+            lua_getinfo(_L, "Sln", &frame);
+            if (frame.what && (strcmp(frame.what, "Lua") == 0 || strcmp(frame.what, "main") == 0))
+                binding = std::string(frame.short_src) + ":" + std::to_string(frame.linedefined);
+
+            if (level >= 10)
+                continue;
+
+            traceback += "\n\t" + std::string(frame.short_src);
+            if (frame.currentline > 0)
+                traceback += ":" + std::to_string(frame.currentline);
+            if (frame.name)
+                traceback += ": in function '" + std::string(frame.name) + "'";
+            else if (frame.what && strcmp(frame.what, "main") == 0)
+                traceback += ": in main chunk";
+            else
+                traceback += ": in function <" + std::string(frame.short_src) + ":" + std::to_string(frame.linedefined) + ">";
+        }
+
+        ELUNA_LOG_ERROR("[Eluna]: Watchdog aborted the function defined at %s after it ran for %u ms on map: %i, instance: %u\nstack traceback:%s",
+            binding.c_str(), E->watchdogBudget, E->GetBoundMapId(), E->GetBoundInstanceId(), traceback.c_str());
+    }
+
+    luaL_error(_L, "call aborted by the watchdog after running for %d ms", int(E->watchdogBudget));
+}
+
 bool Eluna::ExecuteCall(int params, int res)
 {
     int top = lua_gettop(L);
@@ -334,7 +810,15 @@ bool Eluna::ExecuteCall(int params, int res)
 
     // Objects are invalidated when event_level hits 0
     ++event_level;
+    // nested calls run under the watchdog of the outermost call
+    bool watchdog = event_level == 1 && StartWatchdog();
+    if (allocator)
+        allocator->EnterProtectedCall();
     int result = lua_pcall(L, params, res, usetrace ? base : 0);
+    if (allocator)
+        allocator->LeaveProtectedCall();
+    if (watchdog)
+        StopWatchdog();
     --event_level;
 
     if (usetrace)
@@ -349,10 +833,7 @@ bool Eluna::ExecuteCall(int params, int res)
     if (result)
     {
         // Stack: errmsg
-        Report(L);
-
-        // Force garbage collect
-        lua_gc(L, LUA_GCCOLLECT, 0);
+        ReportCallError();
 
         // Push nils for expected amount of results
         for (int i = 0; i < res; ++i)
@@ -607,40 +1088,23 @@ template<> ObjectGuid Eluna::CHECKVAL<ObjectGuid>(int narg)
 
 template<> Object* Eluna::CHECKOBJ<Object>(int narg, bool error)
 {
-    Object* obj = CHECKOBJ<WorldObject>(narg, false);
-    if (!obj)
-        obj = CHECKOBJ<Item>(narg, false);
-    if (!obj)
-        obj = ElunaTemplate<Object>::Check(this, narg, error);
-    return obj;
+    return ElunaTemplate<Object>::CheckDerived(this, narg, error);
 }
 template<> WorldObject* Eluna::CHECKOBJ<WorldObject>(int narg, bool error)
 {
-    WorldObject* obj = CHECKOBJ<Unit>(narg, false);
-    if (!obj)
-        obj = CHECKOBJ<GameObject>(narg, false);
-    if (!obj)
-        obj = CHECKOBJ<Corpse>(narg, false);
-    if (!obj)
-        obj = ElunaTemplate<WorldObject>::Check(this, narg, error);
-    return obj;
+    return ElunaTemplate<WorldObject>::CheckDerived(this, narg, error);
 }
 template<> Unit* Eluna::CHECKOBJ<Unit>(int narg, bool error)
 {
-    Unit* obj = CHECKOBJ<Player>(narg, false);
-    if (!obj)
-        obj = CHECKOBJ<Creature>(narg, false);
-    if (!obj)
-        obj = ElunaTemplate<Unit>::Check(this, narg, error);
-    return obj;
+    return ElunaTemplate<Unit>::CheckDerived(this, narg, error);
 }
 
 template<> ElunaObject* Eluna::CHECKOBJ<ElunaObject>(int narg, bool error)
 {
-    return CHECKTYPE(narg, NULL, error);
+    return CHECKTYPE(narg, NULL, 0, 0, error);
 }
 
-ElunaObject* Eluna::CHECKTYPE(int narg, const char* tname, bool error)
+ElunaObject* Eluna::CHECKTYPE(int narg, const char* tname, uint32 typeIndex, uint64 ancestryMask, bool error)
 {
     if (lua_islightuserdata(L, narg))
     {
@@ -651,7 +1115,8 @@ ElunaObject* Eluna::CHECKTYPE(int narg, const char* tname, bool error)
 
     ElunaObject* elunaObject = static_cast<ElunaObject*>(lua_touserdata(L, narg));
 
-    if (!elunaObject || (tname && elunaObject->GetTypeName() != tname))
+    bool matches = elunaObject && (!tname || elunaObject->GetTypeIndex() == typeIndex || (elunaObject->GetTypeAncestry() & ancestryMask));
+    if (!matches)
     {
         if (error)
         {
@@ -690,33 +1155,36 @@ static void createCancelCallback(Eluna* e, uint64 bindingID, BindingMap<K>* bind
     // Stack: cancel_callback
 }
 
-template<typename K>
-int RegisterBasicBinding(Eluna* e, std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32 event_id, int functionRef, uint32 shots)
+template<Hooks::RegisterTypes R>
+int RegisterBasicBinding(Eluna* e, uint32 event_id, int functionRef, uint32 shots)
 {
-    typedef EventKey<K> Key;
-    auto binding = e->GetBinding<Key>(regtype);
+    typedef typename BindingKeyFor<R>::Type Key;
+    typedef decltype(Key::event_id) K;
+    auto binding = e->GetBinding<R>();
     auto key = Key(static_cast<K>(event_id));
     uint64 bindingID = binding->Insert(key, functionRef, shots);
     createCancelCallback(e, bindingID, binding);
     return 1; // Stack: callback
 }
 
-template<typename K>
-int RegisterEntryBinding(Eluna* e, std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32 entry, uint32 event_id, int functionRef, uint32 shots)
+template<Hooks::RegisterTypes R>
+int RegisterEntryBinding(Eluna* e, uint32 entry, uint32 event_id, int functionRef, uint32 shots)
 {
-    typedef EntryKey<K> Key;
-    auto binding = e->GetBinding<Key>(regtype);
+    typedef typename BindingKeyFor<R>::Type Key;
+    typedef decltype(Key::event_id) K;
+    auto binding = e->GetBinding<R>();
     auto key = Key(static_cast<K>(event_id), entry);
     uint64 bindingID = binding->Insert(key, functionRef, shots);
     createCancelCallback(e, bindingID, binding);
     return 1; // Stack: callback
 }
 
-template<typename K>
-int RegisterUniqueBinding(Eluna* e, std::underlying_type_t<Hooks::RegisterTypes> regtype, ObjectGuid guid, uint32 instanceId, uint32 event_id, int functionRef, uint32 shots)
+template<Hooks::RegisterTypes R>
+int RegisterUniqueBinding(Eluna* e, ObjectGuid guid, uint32 instanceId, uint32 event_id, int functionRef, uint32 shots)
 {
-    typedef UniqueObjectKey<K> Key;
-    auto binding = e->GetBinding<Key>(regtype);
+    typedef typename BindingKeyFor<R>::Type Key;
+    typedef decltype(Key::event_id) K;
+    auto binding = e->GetBinding<R>();
     auto key = Key(static_cast<K>(event_id), guid, instanceId);
     uint64 bindingID = binding->Insert(key, functionRef, shots);
     createCancelCallback(e, bindingID, binding);
@@ -730,32 +1198,32 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
     {
         case Hooks::REGTYPE_SERVER:
             if (event_id < Hooks::SERVER_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::ServerEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_SERVER>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_PLAYER:
             if (event_id < Hooks::PLAYER_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::PlayerEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_PLAYER>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_GUILD:
             if (event_id < Hooks::GUILD_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::GuildEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_GUILD>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_GROUP:
             if (event_id < Hooks::GROUP_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::GroupEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_GROUP>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_VEHICLE:
             if (event_id < Hooks::VEHICLE_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::VehicleEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_VEHICLE>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_BG:
             if (event_id < Hooks::BG_EVENT_COUNT)
-                return RegisterBasicBinding<Hooks::BGEvents>(this, regtype, event_id, functionRef, shots);
+                return RegisterBasicBinding<Hooks::REGTYPE_BG>(this, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_PACKET:
@@ -767,7 +1235,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a creature with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::PacketEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_PACKET>(this, entry, event_id, functionRef, shots);
             }
             break;
 
@@ -780,7 +1248,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a creature with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::CreatureEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_CREATURE>(this, entry, event_id, functionRef, shots);
             }
             break;
 
@@ -793,7 +1261,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "guid was 0!");
                     return 0; // Stack: (empty)
                 }
-                return RegisterUniqueBinding<Hooks::CreatureEvents>(this, regtype, guid, instanceId, event_id, functionRef, shots);
+                return RegisterUniqueBinding<Hooks::REGTYPE_CREATURE_UNIQUE>(this, guid, instanceId, event_id, functionRef, shots);
             }
             break;
 
@@ -806,7 +1274,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a creature with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::GossipEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_CREATURE_GOSSIP>(this, entry, event_id, functionRef, shots);
             }
             break;
 
@@ -819,7 +1287,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a gameobject with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::GameObjectEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_GAMEOBJECT>(this, entry, event_id, functionRef, shots);
             }
             break;
 
@@ -832,13 +1300,13 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a gameobject with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::GossipEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_GAMEOBJECT_GOSSIP>(this, entry, event_id, functionRef, shots);
             }
             break;
 
         case Hooks::REGTYPE_SPELL:
             if (event_id < Hooks::SPELL_EVENT_COUNT)
-                return RegisterEntryBinding<Hooks::SpellEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_SPELL>(this, entry, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_ITEM:
@@ -850,7 +1318,7 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a item with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::ItemEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_ITEM>(this, entry, event_id, functionRef, shots);
             }
             break;
 
@@ -863,19 +1331,23 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
                     luaL_error(L, "Couldn't find a item with (ID: %d)!", entry);
                     return 0; // Stack: (empty)
                 }
-                return RegisterEntryBinding<Hooks::GossipEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_ITEM_GOSSIP>(this, entry, event_id, functionRef, shots);
             }
             break;
 
         case Hooks::REGTYPE_PLAYER_GOSSIP:
             if (event_id < Hooks::GOSSIP_EVENT_COUNT)
-                return RegisterEntryBinding<Hooks::GossipEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_PLAYER_GOSSIP>(this, entry, event_id, functionRef, shots);
             break;
 
         case Hooks::REGTYPE_MAP:
+            if (event_id < Hooks::INSTANCE_EVENT_COUNT)
+                return RegisterEntryBinding<Hooks::REGTYPE_MAP>(this, entry, event_id, functionRef, shots);
+            break;
+
         case Hooks::REGTYPE_INSTANCE:
             if (event_id < Hooks::INSTANCE_EVENT_COUNT)
-                return RegisterEntryBinding<Hooks::InstanceEvents>(this, regtype, entry, event_id, functionRef, shots);
+                return RegisterEntryBinding<Hooks::REGTYPE_INSTANCE>(this, entry, event_id, functionRef, shots);
             break;
     }
     luaL_unref(L, LUA_REGISTRYINDEX, functionRef);
@@ -893,16 +1365,96 @@ int Eluna::Register(std::underlying_type_t<Hooks::RegisterTypes> regtype, uint32
 
 void Eluna::UpdateEluna(uint32 diff)
 {
+    auto updateStart = std::chrono::steady_clock::now();
+
     if (reload && sElunaLoader->GetCacheState() == SCRIPT_CACHE_READY)
+    {
+        if (sElunaConfig->IsBackgroundReloadEnabled())
+        {
+            if (Eluna* E = SwapInReplacement())
+            {
+                // this state is now retired and owned by the replacement, which runs the rest of the update
+                E->eventMgr->UpdateProcessors(diff);
 #if defined ELUNA_TRINITY
-        if (GetQueryProcessor().Empty())
+                E->GetQueryProcessor().ProcessReadyCallbacks();
+#endif
+                E->UpdateGarbageCollector(updateStart);
+                return;
+            }
+        }
+#if defined ELUNA_TRINITY
+        else if (GetQueryProcessor().Empty())
+#else
+        else
 #endif
             _ReloadEluna();
+    }
+
+    UpdateRetiredState();
+    UpdateMemoryLimit(diff);
+
+    if (releaseQuarantines.exchange(false))
+        ReleaseQuarantinedHandlers();
 
     eventMgr->UpdateProcessors(diff);
 #if defined ELUNA_TRINITY
     GetQueryProcessor().ProcessReadyCallbacks();
 #endif
+
+    UpdateGarbageCollector(updateStart);
+}
+
+void Eluna::UpdateGarbageCollector(std::chrono::steady_clock::time_point updateStart)
+{
+    uint32 budget = sElunaConfig->GetConfig(CONFIG_ELUNA_GC_STEP_BUDGET);
+    if (!budget)
+        return;
+
+#if LUA_VERSION_NUM >= 502
+    // scripts are loaded with the automatic collector, after that it only runs here between hooks
+    if (lua_gc(L, LUA_GCISRUNNING, 0))
+        lua_gc(L, LUA_GCSTOP, 0);
+#endif
+
+    // like the automatic collector, wait for the memory to grow after a cycle before starting the next
+    int64 memory = GetLuaMemory(L);
+    if (memory < gcStepThreshold)
+        return;
+
+    // the steps did not keep up with the scripts and the memory doubled over the threshold, so a full cycle is run
+    // instead of letting the memory grow while the collector is stopped
+    if (gcStepThreshold && memory >= gcStepThreshold * 2)
+    {
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        int64 collected = GetLuaMemory(L);
+        gcStepThreshold = collected * 2;
+        ELUNA_LOG_DEBUG("[Eluna]: Garbage collection steps fell behind, ran a full collection from %lld KB to %lld KB for map: %i, instance: %u",
+            static_cast<long long>(memory / 1024), static_cast<long long>(collected / 1024), GetBoundMapId(), GetBoundInstanceId());
+        return;
+    }
+
+#if LUA_VERSION_NUM >= 504
+    // in generational mode a step is a whole minor collection, Lua runs the next one after the memory grows by 20%
+    if (sElunaConfig->GetConfig(CONFIG_ELUNA_GC_GENERATIONAL))
+    {
+        lua_gc(L, LUA_GCSTEP, 0);
+        memory = GetLuaMemory(L);
+        gcStepThreshold = memory + memory / 5;
+        return;
+    }
+#endif
+
+    // the timed events and callbacks of this update used part of the budget, at least one step is always run
+    auto deadline = updateStart + std::chrono::microseconds(budget);
+    do
+    {
+        if (lua_gc(L, LUA_GCSTEP, 0))
+        {
+            // the cycle is finished, Lua starts the next one when the memory has doubled
+            gcStepThreshold = GetLuaMemory(L) * 2;
+            break;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
 }
 
 /*
@@ -910,9 +1462,9 @@ void Eluna::UpdateEluna(uint32 diff)
  */
 void Eluna::CleanUpStack(int number_of_arguments)
 {
-    // Stack: event_id, [arguments]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
-    lua_pop(L, number_of_arguments + 1); // Add 1 because the caller doesn't know about `event_id`.
+    lua_pop(L, number_of_arguments + 3); // Add 3 because the caller doesn't know about `event_id` and the handler arrays.
     // Stack: (empty)
 
 #if !defined TRACKABLE_PTR_NAMESPACE
@@ -928,34 +1480,47 @@ void Eluna::CleanUpStack(int number_of_arguments)
  */
 int Eluna::CallOneFunction(int number_of_functions, int number_of_arguments, int number_of_results)
 {
-    ++number_of_arguments; // Caller doesn't know about `event_id`.
-    ASSERT(number_of_functions > 0 && number_of_arguments > 0 && number_of_results >= 0);
-    // Stack: event_id, [arguments], [functions]
+    ASSERT(number_of_functions > 0 && number_of_arguments >= 0 && number_of_results >= 0);
+    // Stack: [arguments], event_id, handlers1, handlers2
 
-    int functions_top        = lua_gettop(L);
-    int first_function_index = functions_top - number_of_functions + 1;
-    int arguments_top        = first_function_index - 1;
-    int first_argument_index = arguments_top - number_of_arguments + 1;
+    int handlers_top         = lua_gettop(L);
+    int event_id_index       = handlers_top - 2;
+    int first_argument_index = event_id_index - number_of_arguments;
 
-    // Copy the arguments from the bottom of the stack to the top.
-    for (int argument_index = first_argument_index; argument_index <= arguments_top; ++argument_index)
+    // Functions are called from the last one down to the first, the handlers of the second binding map before the first.
+    int handlers_index = handlers_top - 1;
+    int function_index = number_of_functions;
+    int first_handlers_count = static_cast<int>(lua_rawlen(L, handlers_index));
+    if (function_index > first_handlers_count)
     {
-        lua_pushvalue(L, argument_index);
+        handlers_index = handlers_top;
+        function_index -= first_handlers_count;
     }
-    // Stack: event_id, [arguments], [functions], event_id, [arguments]
+    lua_rawgeti(L, handlers_index, function_index);
 
-    ExecuteCall(number_of_arguments, number_of_results);
-    --functions_top;
-    // Stack: event_id, [arguments], [functions - 1], [results]
+    // Copy the event ID and the arguments from the bottom of the stack to the top.
+    lua_pushvalue(L, event_id_index);
+    for (int argument_index = first_argument_index; argument_index < event_id_index; ++argument_index)
+        lua_pushvalue(L, argument_index);
+    // Stack: [arguments], event_id, handlers1, handlers2, function, event_id, [arguments]
 
-    return functions_top + 1; // Return the location of the first result (if any exist).
+    if (!ExecuteCall(number_of_arguments + 1, number_of_results)) // Add 1 because the caller doesn't know about `event_id`.
+        OnHandlerError(handlers_index, function_index);
+    // Stack: [arguments], event_id, handlers1, handlers2, [results]
+
+    return handlers_top + 1; // Return the location of the first result (if any exist).
 }
 
 CreatureAI* Eluna::GetAI(Creature* creature)
 {
+    if (handlerMasks[Hooks::REGTYPE_CREATURE].none() && handlerMasks[Hooks::REGTYPE_CREATURE_UNIQUE].none())
+        return NULL;
+
     for (int i = 1; i < Hooks::CREATURE_EVENT_COUNT; ++i)
     {
         Hooks::CreatureEvents event_id = (Hooks::CreatureEvents)i;
+        if (!HasAnyHandler(Hooks::REGTYPE_CREATURE, event_id) && !HasAnyHandler(Hooks::REGTYPE_CREATURE_UNIQUE, event_id))
+            continue;
 
         typedef EntryKey<Hooks::CreatureEvents> EKey;
         typedef UniqueObjectKey<Hooks::CreatureEvents> UKey;
@@ -963,8 +1528,8 @@ CreatureAI* Eluna::GetAI(Creature* creature)
         auto entryKey = EKey(event_id, creature->GetEntry());
         auto uniqueKey = UKey(event_id, creature->GET_GUID(), creature->GetInstanceId());
 
-        auto CreatureEBindings = GetBinding<EKey>(Hooks::REGTYPE_CREATURE);
-        auto CreatureUBindings = GetBinding<UKey>(Hooks::REGTYPE_CREATURE_UNIQUE);
+        auto CreatureEBindings = GetBinding<Hooks::REGTYPE_CREATURE>();
+        auto CreatureUBindings = GetBinding<Hooks::REGTYPE_CREATURE_UNIQUE>();
 
         if (CreatureEBindings->HasBindingsFor(entryKey) ||
             CreatureUBindings->HasBindingsFor(uniqueKey))
@@ -976,16 +1541,21 @@ CreatureAI* Eluna::GetAI(Creature* creature)
 
 InstanceData* Eluna::GetInstanceData(Map* map)
 {
+    if (handlerMasks[Hooks::REGTYPE_MAP].none() && handlerMasks[Hooks::REGTYPE_INSTANCE].none())
+        return NULL;
+
     for (int i = 1; i < Hooks::INSTANCE_EVENT_COUNT; ++i)
     {
         Hooks::InstanceEvents event_id = (Hooks::InstanceEvents)i;
+        if (!HasAnyHandler(Hooks::REGTYPE_MAP, event_id) && !HasAnyHandler(Hooks::REGTYPE_INSTANCE, event_id))
+            continue;
 
         typedef EntryKey<Hooks::InstanceEvents> Key;
 
         auto key = Key(event_id, map->GetId());
 
-        auto MapBindings = GetBinding<Key>(Hooks::REGTYPE_MAP);
-        auto InstanceBindings = GetBinding<Key>(Hooks::REGTYPE_INSTANCE);
+        auto MapBindings = GetBinding<Hooks::REGTYPE_MAP>();
+        auto InstanceBindings = GetBinding<Hooks::REGTYPE_INSTANCE>();
 
         if (MapBindings->HasBindingsFor(key) ||
             InstanceBindings->HasBindingsFor(key))
@@ -1048,8 +1618,8 @@ void Eluna::FreeInstanceId(uint32 instanceId)
 
         auto key = Key((Hooks::InstanceEvents)i, instanceId);
 
-        auto MapEventBindings = GetBinding<Key>(Hooks::REGTYPE_MAP);
-        auto InstanceEventBindings = GetBinding<Key>(Hooks::REGTYPE_INSTANCE);
+        auto MapEventBindings = GetBinding<Hooks::REGTYPE_MAP>();
+        auto InstanceEventBindings = GetBinding<Hooks::REGTYPE_INSTANCE>();
 
         if (MapEventBindings->HasBindingsFor(key))
             MapEventBindings->Clear(key);
@@ -34,13 +34,20 @@
 #include "Entities/Player.h"
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <mutex>
 #include <memory>
+#include <tuple>
+#include <utility>
+#include "ElunaAllocator.h"
 #include "ElunaSpellWrapper.h"
 
 extern "C"
 {
 #include "lua.h"
+#include "lauxlib.h"
 };
 
 class AuctionHouseObject;
@@ -110,7 +117,6 @@ typedef VehicleInfo Vehicle;
 struct lua_State;
 class EventMgr;
 class ElunaObject;
-class BaseBindingMap;
 template<typename T> class ElunaTemplate;
 
 template<typename K> class BindingMap;
@@ -118,14 +124,97 @@ template<typename T> struct EventKey;
 template<typename T> struct EntryKey;
 template<typename T> struct UniqueObjectKey;
 
+// Maps each register type to the key type of its binding store
+template<Hooks::RegisterTypes R> struct BindingKeyFor;
+template<> struct BindingKeyFor<Hooks::REGTYPE_PACKET>            { typedef EntryKey<Hooks::PacketEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_SERVER>            { typedef EventKey<Hooks::ServerEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_PLAYER>            { typedef EventKey<Hooks::PlayerEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_GUILD>             { typedef EventKey<Hooks::GuildEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_GROUP>             { typedef EventKey<Hooks::GroupEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_CREATURE>          { typedef EntryKey<Hooks::CreatureEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_CREATURE_UNIQUE>   { typedef UniqueObjectKey<Hooks::CreatureEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_VEHICLE>           { typedef EventKey<Hooks::VehicleEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_CREATURE_GOSSIP>   { typedef EntryKey<Hooks::GossipEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_GAMEOBJECT>        { typedef EntryKey<Hooks::GameObjectEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_GAMEOBJECT_GOSSIP> { typedef EntryKey<Hooks::GossipEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_SPELL>             { typedef EntryKey<Hooks::SpellEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_ITEM>              { typedef EntryKey<Hooks::ItemEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_ITEM_GOSSIP>       { typedef EntryKey<Hooks::GossipEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_PLAYER_GOSSIP>     { typedef EntryKey<Hooks::GossipEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_BG>                { typedef EventKey<Hooks::BGEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_MAP>               { typedef EntryKey<Hooks::InstanceEvents> Type; };
+template<> struct BindingKeyFor<Hooks::REGTYPE_INSTANCE>          { typedef EntryKey<Hooks::InstanceEvents> Type; };
+
+// One binding store per register type, each typed by its BindingKeyFor key
+template<typename Seq> struct BindingStoresFor;
+template<size_t... R> struct BindingStoresFor<std::index_sequence<R...>>
+{
+    typedef std::tuple<std::unique_ptr<BindingMap<typename BindingKeyFor<static_cast<Hooks::RegisterTypes>(R)>::Type>>...> Type;
+};
+typedef BindingStoresFor<std::make_index_sequence<Hooks::REGTYPE_COUNT>>::Type BindingStores;
+
 struct LuaScript
 {
     std::string fileext;
     std::string filename;
     std::string filepath;
     std::string modulepath;
-    BytecodeBuffer bytecode;
+    BytecodeBuffer bytecode; // only used while loading, moved to the ScriptCache arena when published
+    size_t bytecodeOffset;
+    size_t bytecodeSize;
     int32 mapId;
+    uint64 filesize;
+    int64 filetime;
+    uint64 contenthash; // hash of the source the bytecode was compiled from, 0 if not hashed
+    bool stripped; // compiled without debug info, see Eluna.StripBytecode
+    uint32 compileTime; // microseconds spent compiling or reading the bytecode cache, 0 if reused from the previous load
+};
+
+// An immutable set of loaded scripts, states keep the snapshot they were opened with until they are reloaded
+struct ScriptCache
+{
+    std::vector<LuaScript> scripts;
+    // Script filename -> index of the first script with that name in scripts
+    std::unordered_map<std::string, size_t> modules;
+    // Indexes of the scripts loaded for all maps, in load order
+    std::vector<size_t> globalScripts;
+    // Map ID -> indexes of the global and map specific scripts loaded for that map, in load order
+    std::unordered_map<int32, std::vector<size_t>> mapScripts;
+    // Bytecode of all scripts
+    BytecodeBuffer arena;
+    std::string requirePath;
+    std::string requirecPath;
+
+    const LuaScript* FindModule(const std::string& name) const
+    {
+        auto itr = modules.find(name);
+        return itr != modules.end() ? &scripts[itr->second] : nullptr;
+    }
+
+    const char* GetBytecode(const LuaScript& script) const { return reinterpret_cast<const char*>(arena.data() + script.bytecodeOffset); }
+
+    const std::vector<size_t>& GetScriptsForMap(int32 mapId) const
+    {
+        auto itr = mapScripts.find(mapId);
+        return itr != mapScripts.end() ? itr->second : globalScripts;
+    }
+};
+
+// Cost of running one script when a state loaded its scripts
+struct ScriptRunProfile
+{
+    size_t script;      // index in the state's ScriptCache scripts
+    uint64 requireTime; // microseconds
+    int64 memoryDelta;  // Lua memory in bytes after running the script minus before
+};
+
+// Registry references of an ElunaTemplate type within one Lua state
+struct ElunaTemplateRefs
+{
+    // The type's metatable
+    int metatable = LUA_NOREF;
+    // Weak valued table of pushed userdata keyed by object pointer, LUA_NOREF if Eluna.UserdataCache is disabled
+    int userdataCache = LUA_NOREF;
 };
 
 enum MethodRegisterState
@@ -143,8 +232,6 @@ enum MethodFlags : uint32
     METHOD_FLAG_DEPRECATED = 0x2
 };
 
-#define ELUNA_STATE_PTR "Eluna State Ptr"
-
 #if defined ELUNA_TRINITY
 #define ELUNA_GAME_API TC_GAME_API
 #define TRACKABLE_PTR_NAMESPACE ::Trinity::
@@ -191,13 +278,78 @@ private:
     // Map from map ID -> Lua table ref
     std::unordered_map<uint32, int> continentDataRefs;
 
-    std::array<std::unique_ptr<BaseBindingMap>, Hooks::REGTYPE_COUNT> bindingMaps;
+    // Per register type, the event IDs that have at least one handler bound.
+    // Kept up to date by the binding maps, declared before them so it outlives them.
+    std::array<Hooks::EventMask, Hooks::REGTYPE_COUNT> handlerMasks;
+    // Number of quarantined handlers in the binding maps, declared before them so it outlives them
+    std::atomic<uint32> quarantinedHandlers { 0 };
+    // Set by ReleaseQuarantinesOnUpdate to release the quarantined handlers on the state's thread
+    std::atomic<bool> releaseQuarantines { false };
 
-    template<typename T>
-    void CreateBinding(Hooks::RegisterTypes type)
+    struct ErrorLogEntry
+    {
+        uint32 lastLogged; // Time the error message was last logged
+        uint32 suppressed; // Times the error happened since then without being logged
+    };
+    // Recent error messages of calls, with Eluna.ErrorLogInterval
+    std::unordered_map<std::string, ErrorLogEntry> errorLog;
+
+    BindingStores bindingStores;
+
+    // Registry references of each ElunaTemplate type registered in this state
+    std::vector<ElunaTemplateRefs> templateRefs;
+
+    // The script cache snapshot this state was opened with
+    std::shared_ptr<const ScriptCache> scriptCache;
+    // What each script cost when RunScripts ran it, in load order
+    std::vector<ScriptRunProfile> scriptProfiles;
+
+    // The state created on a worker thread to replace this one, with Eluna.BackgroundReload
+    std::future<std::unique_ptr<Eluna>> replacementState;
+    // The state this one replaced, closed once its pending async callbacks have run
+    std::unique_ptr<Eluna> retiredState;
+    // Set on a replacement created on a worker thread, which runs its state open handlers when it is swapped in
+    bool deferStateOpen = false;
+    bool stateOpenPending = false;
+
+    // Allocator of the Lua state, null if the Lua version only creates states with its own allocator
+    std::unique_ptr<ElunaAllocator> allocator;
+    // Milliseconds until going over the soft memory limit can run another full garbage collection
+    uint32 memoryCollectCooldown = 0;
+    // Lua memory in bytes at which UpdateEluna starts the next garbage collection cycle, with Eluna.GCStepBudget
+    int64 gcStepThreshold = 0;
+
+    // True while RunScripts runs the scripts, calls then use the Eluna.WatchdogLoadTime budget
+    bool loadingScripts = false;
+    // The watchdog of the outermost call, the hook stays set on coroutines created during the call so it checks `watchdogActive`
+    bool watchdogActive = false;
+    bool watchdogTriggered = false;
+    // Set while StackTrace runs debug.traceback, the watchdog does not raise errors in the message handler
+    bool inMessageHandler = false;
+    uint32 watchdogBudget = 0;
+    std::chrono::steady_clock::time_point watchdogDeadline;
+
+    template<size_t... R>
+    void CreateBindings(std::index_sequence<R...>)
     {
-        auto index = static_cast<std::underlying_type_t<Hooks::RegisterTypes>>(type);
-        bindingMaps[index] = std::make_unique<BindingMap<T>>(L);
+        ((std::get<R>(bindingStores) = std::make_unique<BindingMap<typename BindingKeyFor<static_cast<Hooks::RegisterTypes>(R)>::Type>>(L, &handlerMasks[R], &quarantinedHandlers)), ...);
+    }
+
+    template<typename T, size_t R>
+    BindingMap<T>* GetBindingIfKey()
+    {
+        if constexpr (std::is_same_v<T, typename BindingKeyFor<static_cast<Hooks::RegisterTypes>(R)>::Type>)
+            return std::get<R>(bindingStores).get();
+        else
+            return nullptr;
+    }
+
+    template<typename T, size_t... R>
+    BindingMap<T>* FindBinding(std::underlying_type_t<Hooks::RegisterTypes> type, std::index_sequence<R...>)
+    {
+        BindingMap<T>* binding = nullptr;
+        ((type == R ? (void)(binding = GetBindingIfKey<T, R>()) : (void)0), ...);
+        return binding;
     }
 
     void OpenLua();
@@ -212,6 +364,22 @@ private:
     // Use ReloadEluna() to make eluna reload
     // This is called on world update to reload eluna
     void _ReloadEluna();
+    // Starts creating the replacement state and swaps it in once it is ready, returns the replacement after the swap
+    Eluna* SwapInReplacement();
+    void UpdateRetiredState();
+    void LogScriptLoadReport(uint32 count) const;
+    // Runs a full garbage collection when the Lua state went over the soft memory limit
+    void UpdateMemoryLimit(uint32 diff);
+    // Runs garbage collection steps for what is left of the Eluna.GCStepBudget after the update started at `updateStart`
+    void UpdateGarbageCollector(std::chrono::steady_clock::time_point updateStart);
+    // Sets the count hook that aborts the call when it runs over the watchdog budget, false if there is no budget
+    bool StartWatchdog();
+    void StopWatchdog();
+    static void WatchdogHook(lua_State* _L, lua_Debug* ar);
+    // Logs the error message of a failed call, repeated messages are logged once per Eluna.ErrorLogInterval
+    void ReportCallError();
+    // Counts an error of the handler at `function_index` of the handler array at `handlers_index` and quarantines it after too many
+    void OnHandlerError(int handlers_index, int function_index);
 
     // Some helpers for hooks to call event handlers.
     // The bodies of the templates are in HookHelpers.h, so if you want to use them you need to #include "HookHelpers.h".
@@ -285,14 +453,41 @@ public:
     static int StackTrace(lua_State* _L);
     static void Report(lua_State* _L);
 
+    const ScriptCache* GetScriptCache() const { return scriptCache.get(); }
+    // Pushes the scripts run by this state sorted by require time, slowest first
+    void PushScriptLoadReport();
+    // Memory used by the Lua state, can be called from any thread when the state has its own allocator
+    ElunaMemoryStats GetMemoryStats() const;
+    void PushMemoryStats();
+    // Allocations of the timed event pool of this state, used to size it
+    void PushEventPoolStats();
+    // Handlers not called because they failed too often, can be called from any thread
+    uint32 GetQuarantinedHandlerCount() const { return quarantinedHandlers.load(std::memory_order_relaxed); }
+    // Releases the quarantined handlers on the next update, can be called from any thread
+    void ReleaseQuarantinesOnUpdate() { releaseQuarantines = true; }
+    // Releases the quarantined handler `id` of the register type `regtype`, all handlers of the type if `id` is 0
+    // or all handlers if `regtype` is REGTYPE_COUNT, and returns the number released. Ids are unique per register type
+    uint32 ReleaseQuarantinedHandlers(uint32 regtype = Hooks::REGTYPE_COUNT, uint64 id = 0);
+    void PushQuarantinedHandlers();
+
+#if LUA_VERSION_NUM < 503
+    // Address used as the registry key of the state's Eluna pointer where lua_getextraspace is not available
+    static inline const char StateKey = 0;
+#endif
+
     // Never returns nullptr
     static Eluna* GetEluna(lua_State* L)
     {
-        lua_pushstring(L, ELUNA_STATE_PTR);
+#if LUA_VERSION_NUM >= 503
+        // new threads get a copy of the main thread's extra space, so this works from coroutines too
+        Eluna* E = *static_cast<Eluna**>(lua_getextraspace(L));
+#else
+        lua_pushlightuserdata(L, const_cast<char*>(&StateKey));
         lua_rawget(L, LUA_REGISTRYINDEX);
         ASSERT(lua_islightuserdata(L, -1));
         Eluna* E = static_cast<Eluna*>(lua_touserdata(L, -1));
         lua_pop(L, 1);
+#endif
         ASSERT(E);
         return E;
     }
@@ -364,7 +559,9 @@ public:
     {
         return ElunaTemplate<T>::Check(this, narg, error);
     }
-    ElunaObject* CHECKTYPE(int narg, const char* tname, bool error = true);
+    // Returns the ElunaObject at narg if its type index is typeIndex, or if its ancestry has any bit of ancestryMask.
+    // A NULL tname accepts any ElunaObject.
+    ElunaObject* CHECKTYPE(int narg, const char* tname, uint32 typeIndex, uint64 ancestryMask = 0, bool error = true);
 
     CreatureAI* GetAI(Creature* creature);
     InstanceData* GetInstanceData(Map* map);
@@ -388,17 +585,27 @@ public:
         return 0;
     }
 
-    template<typename T>
-    BindingMap<T>* GetBinding(std::underlying_type_t<Hooks::RegisterTypes> type)
+    // Returns the registry references of the ElunaTemplate type with the given index, see ElunaTemplate<T>::GetTypeIndex
+    ElunaTemplateRefs& GetTemplateRefs(uint32 typeIndex)
     {
-        if (type >= Hooks::REGTYPE_COUNT)
-            return nullptr;
+        if (typeIndex >= templateRefs.size())
+            templateRefs.resize(typeIndex + 1);
+        return templateRefs[typeIndex];
+    }
 
-        auto& binding = bindingMaps[type];
-        if (!binding)
-            return nullptr;
+    // Returns the binding store of register type R, the key type is known at compile time
+    template<Hooks::RegisterTypes R>
+    BindingMap<typename BindingKeyFor<R>::Type>* GetBinding()
+    {
+        return std::get<R>(bindingStores).get();
+    }
 
-        return dynamic_cast<BindingMap<T>*>(binding.get());
+    // Returns the binding store of a register type only known at runtime,
+    // or nullptr if it is out of range or its key type is not T
+    template<typename T>
+    BindingMap<T>* GetBinding(std::underlying_type_t<Hooks::RegisterTypes> type)
+    {
+        return FindBinding<T>(type, std::make_index_sequence<Hooks::REGTYPE_COUNT>());
     }
 
     template<typename T>
@@ -407,7 +614,15 @@ public:
         return GetBinding<T>(static_cast<std::underlying_type_t<Hooks::RegisterTypes>>(type));
     }
 
-    Eluna(Map * map);
+    // Returns true if any handler of this state is bound to `event_id` of `type`, regardless of entry or object.
+    // This is a single bit test, so it can be used to skip building hook arguments when nothing listens.
+    bool HasAnyHandler(Hooks::RegisterTypes type, uint32 event_id) const
+    {
+        return event_id < Hooks::EVENT_ID_LIMIT && handlerMasks[type].test(event_id);
+    }
+
+    // With `deferStateOpen` the state open handlers are not run after the scripts are loaded, see SwapInReplacement
+    Eluna(Map * map, bool deferStateOpen = false);
     ~Eluna();
 
     // Prevent copy
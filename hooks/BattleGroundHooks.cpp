@@ -13,7 +13,9 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<BGEvents>>(REGTYPE_BG);\
+    if (!HasAnyHandler(REGTYPE_BG, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_BG>();\
     auto key = EventKey<BGEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
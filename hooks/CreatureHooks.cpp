@@ -14,8 +14,10 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT, CREATURE) \
-    auto CreatureEventBindings = GetBinding<EntryKey<CreatureEvents>>(REGTYPE_CREATURE);\
-    auto CreatureUniqueBindings = GetBinding<UniqueObjectKey<CreatureEvents>>(REGTYPE_CREATURE_UNIQUE);\
+    if (!HasAnyHandler(REGTYPE_CREATURE, EVENT) && !HasAnyHandler(REGTYPE_CREATURE_UNIQUE, EVENT))\
+        return;\
+    auto CreatureEventBindings = GetBinding<REGTYPE_CREATURE>();\
+    auto CreatureUniqueBindings = GetBinding<REGTYPE_CREATURE_UNIQUE>();\
     auto entry_key = EntryKey<CreatureEvents>(EVENT, CREATURE->GetEntry());\
     auto unique_key = UniqueObjectKey<CreatureEvents>(EVENT, CREATURE->GET_GUID(), CREATURE->GetInstanceId());\
     if (!CreatureEventBindings->HasBindingsFor(entry_key))\
@@ -23,8 +25,10 @@ using namespace Hooks;
             return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, CREATURE, RETVAL) \
-    auto CreatureEventBindings = GetBinding<EntryKey<CreatureEvents>>(REGTYPE_CREATURE);\
-    auto CreatureUniqueBindings = GetBinding<UniqueObjectKey<CreatureEvents>>(REGTYPE_CREATURE_UNIQUE);\
+    if (!HasAnyHandler(REGTYPE_CREATURE, EVENT) && !HasAnyHandler(REGTYPE_CREATURE_UNIQUE, EVENT))\
+        return RETVAL;\
+    auto CreatureEventBindings = GetBinding<REGTYPE_CREATURE>();\
+    auto CreatureUniqueBindings = GetBinding<REGTYPE_CREATURE_UNIQUE>();\
     auto entry_key = EntryKey<CreatureEvents>(EVENT, CREATURE->GetEntry());\
     auto unique_key = UniqueObjectKey<CreatureEvents>(EVENT, CREATURE->GET_GUID(), CREATURE->GetInstanceId());\
     if (!CreatureEventBindings->HasBindingsFor(entry_key))\
@@ -15,13 +15,17 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT, ENTRY) \
-    auto binding = GetBinding<EntryKey<GameObjectEvents>>(REGTYPE_GAMEOBJECT);\
+    if (!HasAnyHandler(REGTYPE_GAMEOBJECT, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_GAMEOBJECT>();\
     auto key = EntryKey<GameObjectEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, ENTRY, RETVAL) \
-    auto binding = GetBinding<EntryKey<GameObjectEvents>>(REGTYPE_GAMEOBJECT);\
+    if (!HasAnyHandler(REGTYPE_GAMEOBJECT, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_GAMEOBJECT>();\
     auto key = EntryKey<GameObjectEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
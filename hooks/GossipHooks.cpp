@@ -14,13 +14,17 @@
 using namespace Hooks;
 
 #define START_HOOK(REGTYPE, EVENT, ENTRY) \
-    auto binding = GetBinding<EntryKey<GossipEvents>>(REGTYPE);\
+    if (!HasAnyHandler(REGTYPE, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE>();\
     auto key = EntryKey<GossipEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(REGTYPE, EVENT, ENTRY, RETVAL) \
-    auto binding = GetBinding<EntryKey<GossipEvents>>(REGTYPE);\
+    if (!HasAnyHandler(REGTYPE, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE>();\
     auto key = EntryKey<GossipEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
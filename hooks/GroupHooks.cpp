@@ -13,13 +13,17 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<GroupEvents>>(REGTYPE_GROUP);\
+    if (!HasAnyHandler(REGTYPE_GROUP, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_GROUP>();\
     auto key = EventKey<GroupEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, RETVAL) \
-    auto binding = GetBinding<EventKey<GroupEvents>>(REGTYPE_GROUP);\
+    if (!HasAnyHandler(REGTYPE_GROUP, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_GROUP>();\
     auto key = EventKey<GroupEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
@@ -13,7 +13,9 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<GuildEvents>>(REGTYPE_GUILD);\
+    if (!HasAnyHandler(REGTYPE_GUILD, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_GUILD>();\
     auto key = EventKey<GuildEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
@@ -62,33 +62,30 @@ struct LuaRet<std::string>
 /*
  * Sets up the stack so that event handlers can be called.
  *
- * Returns the number of functions that were pushed onto the stack.
+ * Pushes the event ID and the handler arrays of both binding maps after the arguments,
+ *   `CallOneFunction` then calls the handlers straight from the arrays.
+ *
+ * Returns the number of functions that can be called.
  */
 template<typename K1, typename K2>
 int Eluna::SetupStack(BindingMap<K1>* bindings1, BindingMap<K2>* bindings2, const K1& key1, const K2& key2, int number_of_arguments)
 {
     ASSERT(number_of_arguments == this->push_counter);
     ASSERT(key1.event_id == key2.event_id);
+    ASSERT(lua_gettop(L) >= number_of_arguments);
     // Stack: [arguments]
 
     HookPush(key1.event_id);
     this->push_counter = 0;
-    ++number_of_arguments;
     // Stack: [arguments], event_id
 
-    int arguments_top = lua_gettop(L);
-    int first_argument_index = arguments_top - number_of_arguments + 1;
-    ASSERT(arguments_top >= number_of_arguments);
-
-    lua_insert(L, first_argument_index);
-    // Stack: event_id, [arguments]
-
-    bindings1->PushRefsFor(key1);
+    int number_of_functions = bindings1->PushHandlersFor(key1);
     if (bindings2)
-        bindings2->PushRefsFor(key2);
-    // Stack: event_id, [arguments], [functions]
+        number_of_functions += bindings2->PushHandlersFor(key2);
+    else
+        lua_pushnil(L);
+    // Stack: [arguments], event_id, handlers1, handlers2
 
-    int number_of_functions = lua_gettop(L) - arguments_top;
     return number_of_functions;
 }
 
@@ -99,17 +96,17 @@ template<typename T>
 void Eluna::ReplaceArgument(T value, int index)
 {
     ASSERT(index > 0 && index <= lua_gettop(L));
-    // Stack: event_id, [arguments], [functions], [results]
+    // Stack: [arguments], event_id, handlers1, handlers2, [results]
 
     Push(value);
-    // Stack: event_id, [arguments], [functions], [results], value
+    // Stack: [arguments], event_id, handlers1, handlers2, [results], value
 
-    lua_replace(L, index + 1);
-    // Stack: event_id, [arguments and value], [functions], [results]
+    lua_replace(L, index);
+    // Stack: [arguments and value], event_id, handlers1, handlers2, [results]
 }
 
 /*
- * indices[i] = stack index captured BEFORE SetupStack() inserts event_id.
+ * indices[i] = stack index of the argument, captured before SetupStack().
  * If indices[i] == 0, we won't ReplaceArgument for that output.
  */
 template<typename... Outs, size_t... Is>
@@ -139,15 +136,15 @@ void Eluna::CallAllFunctions(BindingMap<K1>* bindings1, BindingMap<K2>* bindings
     // Stack: [arguments]
 
     int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
-    // Stack: event_id, [arguments], [functions]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
     while (number_of_functions > 0)
     {
         CallOneFunction(number_of_functions, number_of_arguments, 0);
         --number_of_functions;
-        // Stack: event_id, [arguments], [functions - 1]
+        // Stack: [arguments], event_id, handlers1, handlers2
     }
-    // Stack: event_id, [arguments]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
     CleanUpStack(number_of_arguments);
     // Stack: (empty)
@@ -167,21 +164,21 @@ bool Eluna::CallAllFunctionsBool(BindingMap<K1>* bindings1, BindingMap<K2>* bind
     // Stack: [arguments]
 
     int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
-    // Stack: event_id, [arguments], [functions]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
     while (number_of_functions > 0)
     {
         int r = CallOneFunction(number_of_functions, number_of_arguments, 1);
         --number_of_functions;
-        // Stack: event_id, [arguments], [functions - 1], result
+        // Stack: [arguments], event_id, handlers1, handlers2, result
 
         if (lua_isboolean(L, r) && (lua_toboolean(L, r) == 1) != default_value)
             result = !default_value;
 
         lua_pop(L, 1);
-        // Stack: event_id, [arguments], [functions - 1]
+        // Stack: [arguments], event_id, handlers1, handlers2
     }
-    // Stack: event_id, [arguments]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
     CleanUpStack(number_of_arguments);
     // Stack: (empty)
@@ -203,18 +200,18 @@ void Eluna::CallAllFunctionsMultiReturn(BindingMap<K1>* bindings1, BindingMap<K2
     const int number_of_arguments = this->push_counter;
 
     int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
-    // Stack: event_id, [arguments], [functions]
+    // Stack: [arguments], event_id, handlers1, handlers2
 
     while (number_of_functions > 0)
     {
         int r = CallOneFunction(number_of_functions, number_of_arguments, number_of_returns);
         --number_of_functions;
-        // Stack: event_id, [arguments], [functions - 1], [ret0..retN-1]
+        // Stack: [arguments], event_id, handlers1, handlers2, [ret0..retN-1]
 
         ApplyMultiReturnsImpl(r, outs, out_arg_indices, std::index_sequence_for<Outs...>{});
 
         lua_pop(L, number_of_returns);
-        // Stack: event_id, [arguments], [functions - 1]
+        // Stack: [arguments], event_id, handlers1, handlers2
     }
 
     CleanUpStack(number_of_arguments);
@@ -232,12 +229,12 @@ int Eluna::CallAllFunctionsInt(BindingMap<K1>* bindings1, BindingMap<K2>* bindin
     int number_of_arguments = this->push_counter;
     // Stack: [arguments]
     int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
-    // Stack: event_id, [arguments], [functions]
+    // Stack: [arguments], event_id, handlers1, handlers2
     while (number_of_functions > 0)
     {
         int r = CallOneFunction(number_of_functions, number_of_arguments, 1);
         --number_of_functions;
-        // Stack: event_id, [arguments], [functions - 1], result
+        // Stack: [arguments], event_id, handlers1, handlers2, result
         if (lua_isnumber(L, r))
         {
             int32 ret = static_cast<int32>(lua_tointeger(L, r));
@@ -245,9 +242,9 @@ int Eluna::CallAllFunctionsInt(BindingMap<K1>* bindings1, BindingMap<K2>* bindin
                 result = ret;
         }
         lua_pop(L, 1);
-        // Stack: event_id, [arguments], [functions - 1]
+        // Stack: [arguments], event_id, handlers1, handlers2
     }
-    // Stack: event_id, [arguments]
+    // Stack: [arguments], event_id, handlers1, handlers2
     CleanUpStack(number_of_arguments);
     // Stack: (empty)
     return result;
@@ -256,11 +253,7 @@ int Eluna::CallAllFunctionsInt(BindingMap<K1>* bindings1, BindingMap<K2>* bindin
 template<typename K1, typename K2, typename T>
 void Eluna::CallAllFunctionsTable(BindingMap<K1>* bindings1, BindingMap<K2>* bindings2, const K1& key1, const K2& key2, std::list<T*>& list)
 {
-    const int number_of_arguments = this->push_counter;
-    int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
-    // Stack: event_id, [arguments], [functions]
-
-    // Build table from list at a known stack position
+    // Build table from list as the last argument, the handlers can modify it
     lua_newtable(L);
     int tableIndex = lua_gettop(L);
     int i = 1;
@@ -269,11 +262,15 @@ void Eluna::CallAllFunctionsTable(BindingMap<K1>* bindings1, BindingMap<K2>* bin
         Push(entry);
         lua_rawseti(L, tableIndex, i++);
     }
+    ++this->push_counter;
+
+    const int number_of_arguments = this->push_counter;
+    int number_of_functions = SetupStack(bindings1, bindings2, key1, key2, number_of_arguments);
+    // Stack: [arguments], table, event_id, handlers1, handlers2
 
     while (number_of_functions > 0)
     {
-        lua_pushvalue(L, tableIndex);
-        CallOneFunction(number_of_functions, number_of_arguments + 1, 0);
+        CallOneFunction(number_of_functions, number_of_arguments, 0);
         --number_of_functions;
     }
 
@@ -287,7 +284,6 @@ void Eluna::CallAllFunctionsTable(BindingMap<K1>* bindings1, BindingMap<K2>* bin
         lua_pop(L, 1);
     }
 
-    lua_pop(L, 1); // pop table
     CleanUpStack(number_of_arguments);
 }
 
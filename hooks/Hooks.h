@@ -10,6 +10,7 @@
 #if defined ELUNA_CMANGOS
 #include "Platform/Define.h"
 #endif
+#include <bitset>
 #include <utility>
 
 struct EventEntry
@@ -512,6 +513,28 @@ namespace Hooks
     {
         return { HookTypeTable, CountOf(HookTypeTable) };
     }
+
+    // Upper bound (exclusive) of the event IDs of each event enum, used to size event indexed storage
+    template<typename T> struct EventCount;
+    template<> struct EventCount<PacketEvents>     { static constexpr size_t value = PACKET_EVENT_COUNT; };
+    template<> struct EventCount<ServerEvents>     { static constexpr size_t value = SERVER_EVENT_COUNT; };
+    template<> struct EventCount<PlayerEvents>     { static constexpr size_t value = PLAYER_EVENT_COUNT; };
+    template<> struct EventCount<GuildEvents>      { static constexpr size_t value = GUILD_EVENT_COUNT; };
+    template<> struct EventCount<GroupEvents>      { static constexpr size_t value = GROUP_EVENT_COUNT; };
+    template<> struct EventCount<VehicleEvents>    { static constexpr size_t value = VEHICLE_EVENT_COUNT; };
+    template<> struct EventCount<CreatureEvents>   { static constexpr size_t value = CREATURE_EVENT_COUNT; };
+    template<> struct EventCount<GameObjectEvents> { static constexpr size_t value = GAMEOBJECT_EVENT_COUNT; };
+    template<> struct EventCount<SpellEvents>      { static constexpr size_t value = SPELL_EVENT_COUNT; };
+    template<> struct EventCount<ItemEvents>       { static constexpr size_t value = ITEM_EVENT_COUNT; };
+    template<> struct EventCount<GossipEvents>     { static constexpr size_t value = GOSSIP_EVENT_COUNT; };
+    template<> struct EventCount<BGEvents>         { static constexpr size_t value = BG_EVENT_COUNT; };
+    template<> struct EventCount<InstanceEvents>   { static constexpr size_t value = INSTANCE_EVENT_COUNT; };
+
+    // Event IDs are stored as uint8 (see EventEntry), so every event enum fits below this limit
+    static constexpr size_t EVENT_ID_LIMIT = 256;
+
+    // One bit per event ID, set while at least one handler is bound to that event
+    typedef std::bitset<EVENT_ID_LIMIT> EventMask;
 };
 
 #endif // _HOOKS_H
@@ -15,8 +15,10 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT, AI) \
-    auto MapEventBindings = GetBinding<EntryKey<InstanceEvents>>(REGTYPE_MAP);\
-    auto InstanceEventBindings = GetBinding<EntryKey<InstanceEvents>>(REGTYPE_INSTANCE);\
+    if (!HasAnyHandler(REGTYPE_MAP, EVENT) && !HasAnyHandler(REGTYPE_INSTANCE, EVENT))\
+        return;\
+    auto MapEventBindings = GetBinding<REGTYPE_MAP>();\
+    auto InstanceEventBindings = GetBinding<REGTYPE_INSTANCE>();\
     auto mapKey = EntryKey<InstanceEvents>(EVENT, AI->instance->GetId());\
     auto instanceKey = EntryKey<InstanceEvents>(EVENT, AI->instance->GetInstanceId());\
     if (!MapEventBindings->HasBindingsFor(mapKey) && !InstanceEventBindings->HasBindingsFor(instanceKey))\
@@ -25,8 +27,10 @@ using namespace Hooks;
     HookPush<Map>(AI->instance)
 
 #define START_HOOK_WITH_RETVAL(EVENT, AI, RETVAL) \
-    auto MapEventBindings = GetBinding<EntryKey<InstanceEvents>>(REGTYPE_MAP);\
-    auto InstanceEventBindings = GetBinding<EntryKey<InstanceEvents>>(REGTYPE_INSTANCE);\
+    if (!HasAnyHandler(REGTYPE_MAP, EVENT) && !HasAnyHandler(REGTYPE_INSTANCE, EVENT))\
+        return RETVAL;\
+    auto MapEventBindings = GetBinding<REGTYPE_MAP>();\
+    auto InstanceEventBindings = GetBinding<REGTYPE_INSTANCE>();\
     auto mapKey = EntryKey<InstanceEvents>(EVENT, AI->instance->GetId());\
     auto instanceKey = EntryKey<InstanceEvents>(EVENT, AI->instance->GetInstanceId());\
     if (!MapEventBindings->HasBindingsFor(mapKey) && !InstanceEventBindings->HasBindingsFor(instanceKey))\
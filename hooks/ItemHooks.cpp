@@ -14,13 +14,17 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT, ENTRY) \
-    auto binding = GetBinding<EntryKey<ItemEvents>>(REGTYPE_ITEM);\
+    if (!HasAnyHandler(REGTYPE_ITEM, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_ITEM>();\
     auto key = EntryKey<ItemEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, ENTRY, RETVAL) \
-    auto binding = GetBinding<EntryKey<ItemEvents>>(REGTYPE_ITEM);\
+    if (!HasAnyHandler(REGTYPE_ITEM, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_ITEM>();\
     auto key = EntryKey<ItemEvents>(EVENT, ENTRY);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
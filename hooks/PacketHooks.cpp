@@ -14,13 +14,17 @@
 using namespace Hooks;
 
 #define START_HOOK_SERVER(EVENT) \
-    auto binding = GetBinding<EventKey<ServerEvents>>(REGTYPE_SERVER);\
+    if (!HasAnyHandler(REGTYPE_SERVER, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_SERVER>();\
     auto key = EventKey<ServerEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_PACKET(EVENT, OPCODE) \
-    auto binding = GetBinding<EntryKey<PacketEvents>>(REGTYPE_PACKET);\
+    if (!HasAnyHandler(REGTYPE_PACKET, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_PACKET>();\
     auto key = EntryKey<PacketEvents>(EVENT, OPCODE);\
     if (!binding->HasBindingsFor(key))\
         return;
@@ -11,19 +11,24 @@
 #include "ElunaIncludes.h"
 #include "ElunaTemplate.h"
 #include "ElunaLoader.h"
+#include "ElunaMgr.h"
 #include <algorithm> // std::transform
 #include <cstdlib> // strtol
 
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<PlayerEvents>>(REGTYPE_PLAYER);\
+    if (!HasAnyHandler(REGTYPE_PLAYER, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_PLAYER>();\
     auto key = EventKey<PlayerEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, RETVAL) \
-    auto binding = GetBinding<EventKey<PlayerEvents>>(REGTYPE_PLAYER);\
+    if (!HasAnyHandler(REGTYPE_PLAYER, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_PLAYER>();\
     auto key = EventKey<PlayerEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
@@ -91,6 +96,42 @@ bool Eluna::OnCommand(Player* player, const char* text)
 
             return false;
         }
+
+        const std::string quarantine_command = "eluna quarantine";
+        if (reload.find(quarantine_command) == 0)
+        {
+            bool release = reload.find("release", quarantine_command.length()) != std::string::npos;
+
+            // the handlers belong to the map threads, so only the counts are read and releases happen on the next update
+            std::vector<std::string> lines;
+            uint32 total = 0;
+            sElunaMgr->ForEach([&](Eluna* E)
+            {
+                uint32 count = E->GetQuarantinedHandlerCount();
+                if (!count)
+                    return;
+
+                total += count;
+                lines.push_back("Map " + std::to_string(E->GetBoundMapId()) + " instance " + std::to_string(E->GetBoundInstanceId()) + ": " + std::to_string(count) + " quarantined handlers");
+                if (release)
+                    E->ReleaseQuarantinesOnUpdate();
+            });
+
+            if (release)
+                lines.push_back("Releasing " + std::to_string(total) + " quarantined Eluna handlers on the next update");
+            else
+                lines.push_back(std::to_string(total) + " quarantined Eluna handlers, use .eluna quarantine release to call them again");
+
+            for (const std::string& line : lines)
+            {
+                if (player)
+                    ChatHandler(player->GetSession()).SendSysMessage(line.c_str());
+                else
+                    ELUNA_LOG_INFO("[Eluna]: %s", line.c_str());
+            }
+
+            return false;
+        }
     }
 
     START_HOOK_WITH_RETVAL(PLAYER_EVENT_ON_COMMAND, true);
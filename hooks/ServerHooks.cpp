@@ -15,13 +15,17 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<ServerEvents>>(REGTYPE_SERVER);\
+    if (!HasAnyHandler(REGTYPE_SERVER, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_SERVER>();\
     auto key = EventKey<ServerEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, RETVAL) \
-    auto binding = GetBinding<EventKey<ServerEvents>>(REGTYPE_SERVER);\
+    if (!HasAnyHandler(REGTYPE_SERVER, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_SERVER>();\
     auto key = EventKey<ServerEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
@@ -14,13 +14,17 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT, SPELL) \
-    auto binding = GetBinding<EntryKey<SpellEvents>>(REGTYPE_SPELL);\
+    if (!HasAnyHandler(REGTYPE_SPELL, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_SPELL>();\
     auto key = EntryKey<SpellEvents>(EVENT, SPELL->GetSpellInfo()->Id);\
     if (!binding->HasBindingsFor(key))\
         return;
 
 #define START_HOOK_WITH_RETVAL(EVENT, SPELL, RETVAL) \
-    auto binding = GetBinding<EntryKey<SpellEvents>>(REGTYPE_SPELL);\
+    if (!HasAnyHandler(REGTYPE_SPELL, EVENT))\
+        return RETVAL;\
+    auto binding = GetBinding<REGTYPE_SPELL>();\
     auto key = EntryKey<SpellEvents>(EVENT, SPELL->GetSpellInfo()->Id);\
     if (!binding->HasBindingsFor(key))\
         return RETVAL;
@@ -15,7 +15,9 @@
 using namespace Hooks;
 
 #define START_HOOK(EVENT) \
-    auto binding = GetBinding<EventKey<VehicleEvents>>(REGTYPE_VEHICLE);\
+    if (!HasAnyHandler(REGTYPE_VEHICLE, EVENT))\
+        return;\
+    auto binding = GetBinding<REGTYPE_VEHICLE>();\
     auto key = EventKey<VehicleEvents>(EVENT);\
     if (!binding->HasBindingsFor(key))\
         return;
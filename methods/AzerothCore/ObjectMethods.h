@@ -455,9 +455,9 @@ namespace LuaObject
     ElunaRegister<Object> ObjectMethods[] =
     {
         // Getters
-        { "GetEntry", &LuaObject::GetEntry },
-        { "GetGUID", &LuaObject::GetGUID },
-        { "GetGUIDLow", &LuaObject::GetGUIDLow },
+        { "GetEntry", ElunaDirect<&LuaObject::GetEntry>() },
+        { "GetGUID", ElunaDirect<&LuaObject::GetGUID>() },
+        { "GetGUIDLow", ElunaDirect<&LuaObject::GetGUIDLow>() },
         { "GetInt32Value", &LuaObject::GetInt32Value },
         { "GetUInt32Value", &LuaObject::GetUInt32Value },
         { "GetFloatValue", &LuaObject::GetFloatValue },
@@ -480,7 +480,7 @@ namespace LuaObject
         { "SetFlag", &LuaObject::SetFlag },
 
         // Boolean
-        { "IsInWorld", &LuaObject::IsInWorld },
+        { "IsInWorld", ElunaDirect<&LuaObject::IsInWorld>() },
         { "HasFlag", &LuaObject::HasFlag },
 
         // Other
@@ -1131,11 +1131,11 @@ namespace LuaWorldObject
         { "GetInstanceId", &LuaWorldObject::GetInstanceId },
         { "GetAreaId", &LuaWorldObject::GetAreaId },
         { "GetZoneId", &LuaWorldObject::GetZoneId },
-        { "GetMapId", &LuaWorldObject::GetMapId },
-        { "GetX", &LuaWorldObject::GetX },
-        { "GetY", &LuaWorldObject::GetY },
-        { "GetZ", &LuaWorldObject::GetZ },
-        { "GetO", &LuaWorldObject::GetO },
+        { "GetMapId", ElunaDirect<&LuaWorldObject::GetMapId>() },
+        { "GetX", ElunaDirect<&LuaWorldObject::GetX>() },
+        { "GetY", ElunaDirect<&LuaWorldObject::GetY>() },
+        { "GetZ", ElunaDirect<&LuaWorldObject::GetZ>() },
+        { "GetO", ElunaDirect<&LuaWorldObject::GetO>() },
         { "GetLocation", &LuaWorldObject::GetLocation },
         { "GetPlayersInRange", &LuaWorldObject::GetPlayersInRange },
         { "GetCreaturesInRange", &LuaWorldObject::GetCreaturesInRange },
@@ -40,6 +40,109 @@ namespace LuaGlobalFunctions
         return 1;
     }
 
+    /**
+     * Returns what running each script cost when the Lua state loaded its scripts, slowest first.
+     *
+     * Each entry is a table with the fields:
+     *
+     *     name         -- script file name without extension
+     *     path         -- script file path
+     *     runTime      -- milliseconds spent running the script with require
+     *     compileTime  -- milliseconds spent compiling the script, 0 if it was unchanged since the previous load
+     *     bytecodeSize -- size of the compiled script in bytes
+     *     memory       -- change in Lua memory in bytes while running the script
+     *
+     * @return table report
+     */
+    int GetScriptLoadReport(Eluna* E)
+    {
+        E->PushScriptLoadReport();
+        return 1;
+    }
+
+    /**
+     * Returns the memory used by the Lua state the script runs in.
+     *
+     * The result is a table with the fields:
+     *
+     *     live              -- bytes currently allocated
+     *     peak              -- most bytes allocated at once since the state was opened
+     *     pooled            -- bytes kept by the allocator to reuse for small blocks
+     *     softLimit         -- bytes after which a full garbage collection is run, 0 for no limit
+     *     hardLimit         -- bytes after which allocations fail, 0 for no limit
+     *     failedAllocations -- allocations refused because of the hard limit
+     *
+     * Only `live` is set if the state uses the allocator of the Lua library, which LuaJIT can require.
+     *
+     * @return table stats
+     */
+    int GetMemoryStats(Eluna* E)
+    {
+        E->PushMemoryStats();
+        return 1;
+    }
+
+    /**
+     * Returns the allocations of the timed events of the Lua state the script runs in.
+     *
+     * Timed events are allocated from slabs of a pool that reuses freed events. The result is a table with the fields:
+     *
+     *     live     -- timed events currently allocated
+     *     peak     -- most timed events allocated at once
+     *     capacity -- timed events the allocated slabs can hold
+     *     allocs   -- timed events allocated since the state was opened
+     *     frees    -- timed events freed since the state was opened
+     *
+     * @return table stats
+     */
+    int GetEventPoolStats(Eluna* E)
+    {
+        E->PushEventPoolStats();
+        return 1;
+    }
+
+    /**
+     * Returns the event handlers of the Lua state that are quarantined because they raised too many errors.
+     *
+     * Each entry is a table with the fields:
+     *
+     *     regtype       -- type of the events the handler is registered for, used with [Global:ReleaseQuarantinedHandlers]
+     *     id            -- ID of the handler within its `regtype`, used with [Global:ReleaseQuarantinedHandlers]
+     *     event         -- event ID the handler is registered for
+     *     source        -- file and line the handler function is defined at
+     *     quarantines   -- times the handler has been quarantined, each quarantine lasts twice as long as the previous
+     *     remainingTime -- milliseconds until the handler is called again
+     *
+     * @return table handlers
+     */
+    int GetQuarantinedHandlers(Eluna* E)
+    {
+        E->PushQuarantinedHandlers();
+        return 1;
+    }
+
+    /**
+     * Calls the quarantined event handlers of the Lua state again, or only the handler with the given type and ID.
+     *
+     * Handler IDs are only unique within a type, so both are taken from the same entry of [Global:GetQuarantinedHandlers].
+     * Released handlers start over with the shortest quarantine.
+     *
+     * @proto count = ()
+     * @proto count = (regtype)
+     * @proto count = (regtype, id)
+     * @param uint32 regtype : type of the handler from [Global:GetQuarantinedHandlers], all handlers of the type if no ID is given
+     * @param uint64 id = 0 : ID of the handler from [Global:GetQuarantinedHandlers]
+     * @return uint32 count : number of released handlers
+     */
+    int ReleaseQuarantinedHandlers(Eluna* E)
+    {
+        uint32 regtype = E->CHECKVAL<uint32>(1, Hooks::REGTYPE_COUNT);
+        uint64 id = E->CHECKVAL<uint64>(2, 0);
+
+        E->Push(E->ReleaseQuarantinedHandlers(regtype, id));
+        return 1;
+    }
+
     /**
      * Returns emulator .conf RealmID
      *
@@ -2542,7 +2645,7 @@ namespace LuaGlobalFunctions
     int ClearBattleGroundEvents(Eluna* E)
     {
         typedef EventKey<Hooks::BGEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_BG);
+        auto binding = E->GetBinding<Hooks::REGTYPE_BG>();
 
         if (lua_isnoneornil(E->L, 1))
         {
@@ -2574,7 +2677,7 @@ namespace LuaGlobalFunctions
     int ClearCreatureEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::CreatureEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_CREATURE);
+        auto binding = E->GetBinding<Hooks::REGTYPE_CREATURE>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2611,7 +2714,7 @@ namespace LuaGlobalFunctions
     int ClearUniqueCreatureEvents(Eluna* E)
     {
         typedef UniqueObjectKey<Hooks::CreatureEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_CREATURE_UNIQUE);
+        auto binding = E->GetBinding<Hooks::REGTYPE_CREATURE_UNIQUE>();
 
         if (lua_isnoneornil(E->L, 3))
         {
@@ -2649,7 +2752,7 @@ namespace LuaGlobalFunctions
     int ClearCreatureGossipEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::GossipEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_CREATURE_GOSSIP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_CREATURE_GOSSIP>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2685,7 +2788,7 @@ namespace LuaGlobalFunctions
     int ClearGameObjectEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::GameObjectEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_GAMEOBJECT);
+        auto binding = E->GetBinding<Hooks::REGTYPE_GAMEOBJECT>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2721,7 +2824,7 @@ namespace LuaGlobalFunctions
     int ClearGameObjectGossipEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::GossipEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_GAMEOBJECT_GOSSIP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_GAMEOBJECT_GOSSIP>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2753,7 +2856,7 @@ namespace LuaGlobalFunctions
     int ClearGroupEvents(Eluna* E)
     {
         typedef EventKey<Hooks::GroupEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_GROUP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_GROUP>();
 
         if (lua_isnoneornil(E->L, 1))
         {
@@ -2781,7 +2884,7 @@ namespace LuaGlobalFunctions
     int ClearGuildEvents(Eluna* E)
     {
         typedef EventKey<Hooks::GuildEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_GUILD);
+        auto binding = E->GetBinding<Hooks::REGTYPE_GUILD>();
 
         if (lua_isnoneornil(E->L, 1))
         {
@@ -2813,7 +2916,7 @@ namespace LuaGlobalFunctions
     int ClearItemEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::ItemEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_ITEM);
+        auto binding = E->GetBinding<Hooks::REGTYPE_ITEM>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2849,7 +2952,7 @@ namespace LuaGlobalFunctions
     int ClearItemGossipEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::GossipEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_ITEM_GOSSIP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_ITEM_GOSSIP>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2882,7 +2985,7 @@ namespace LuaGlobalFunctions
     int ClearPacketEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::PacketEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_PACKET);
+        auto binding = E->GetBinding<Hooks::REGTYPE_PACKET>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2914,7 +3017,7 @@ namespace LuaGlobalFunctions
     int ClearPlayerEvents(Eluna* E)
     {
         typedef EventKey<Hooks::PlayerEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_PLAYER);
+        auto binding = E->GetBinding<Hooks::REGTYPE_PLAYER>();
 
         if (lua_isnoneornil(E->L, 1))
         {
@@ -2943,7 +3046,7 @@ namespace LuaGlobalFunctions
     int ClearPlayerGossipEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::GossipEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_PLAYER_GOSSIP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_PLAYER_GOSSIP>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -2975,7 +3078,7 @@ namespace LuaGlobalFunctions
     int ClearServerEvents(Eluna* E)
     {
         typedef EventKey<Hooks::ServerEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_SERVER);
+        auto binding = E->GetBinding<Hooks::REGTYPE_SERVER>();
 
         if (lua_isnoneornil(E->L, 1))
         {
@@ -3004,7 +3107,7 @@ namespace LuaGlobalFunctions
     int ClearMapEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::InstanceEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_MAP);
+        auto binding = E->GetBinding<Hooks::REGTYPE_MAP>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -3038,7 +3141,7 @@ namespace LuaGlobalFunctions
     int ClearInstanceEvents(Eluna* E)
     {
         typedef EntryKey<Hooks::InstanceEvents> Key;
-        auto binding = E->GetBinding<Key>(Hooks::REGTYPE_INSTANCE);
+        auto binding = E->GetBinding<Hooks::REGTYPE_INSTANCE>();
 
         if (lua_isnoneornil(E->L, 2))
         {
@@ -3114,6 +3217,11 @@ namespace LuaGlobalFunctions
         // Getters
         { "GetLuaEngine", &LuaGlobalFunctions::GetLuaEngine },
         { "GetCoreName", &LuaGlobalFunctions::GetCoreName },
+        { "GetScriptLoadReport", &LuaGlobalFunctions::GetScriptLoadReport },
+        { "GetMemoryStats", &LuaGlobalFunctions::GetMemoryStats },
+        { "GetEventPoolStats", &LuaGlobalFunctions::GetEventPoolStats },
+        { "GetQuarantinedHandlers", &LuaGlobalFunctions::GetQuarantinedHandlers },
+        { "ReleaseQuarantinedHandlers", &LuaGlobalFunctions::ReleaseQuarantinedHandlers },
         { "GetRealmID", &LuaGlobalFunctions::GetRealmID },
         { "GetCoreVersion", &LuaGlobalFunctions::GetCoreVersion },
         { "GetCoreExpansion", &LuaGlobalFunctions::GetCoreExpansion },